@@ -0,0 +1,51 @@
+# Embed a SPIR-V file in a C source file, run as a script:
+#
+#   cmake -DINPUT=<file.spv> -DSOURCE=<file.c> -DHEADER=<file.h> -DNAME=<name>
+#         -P mc_embed.cmake
+#
+# The code is stored as 32-bit words, so it is suitably aligned to be passed
+# to `mc_program_code_create_from_spirv()` without a copy.
+
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" hexLength)
+math(EXPR size "${hexLength} / 2")
+math(EXPR rem "${size} % 4")
+
+if(size EQUAL 0 OR NOT rem EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not valid SPIR-V")
+endif()
+
+# SPIR-V is written in host byte order, assumed little endian
+set(byte "[0-9a-f][0-9a-f]")
+string(
+        REGEX REPLACE "(${byte})(${byte})(${byte})(${byte})"
+        "0x\\4\\3\\2\\1, " words "${hex}"
+)
+string(REPEAT "0x[0-9a-f]+, " 5 line)
+string(REGEX REPLACE "(${line}0x[0-9a-f]+,) " "\\1\n    " words "${words}")
+string(STRIP "${words}" words)
+
+get_filename_component(headerName "${HEADER}" NAME)
+string(TOUPPER "${NAME}" guard)
+
+file(
+        WRITE "${HEADER}"
+        "// generated by mc_add_shader(), do not edit\n"
+        "#ifndef ${guard}_SPV_H\n"
+        "#define ${guard}_SPV_H\n\n"
+        "#include <stddef.h>\n"
+        "#include <stdint.h>\n\n"
+        "extern const uint32_t ${NAME}[];\n"
+        "extern const size_t ${NAME}_size; // in bytes\n\n"
+        "#endif // ${guard}_SPV_H\n"
+)
+
+file(
+        WRITE "${SOURCE}"
+        "// generated by mc_add_shader(), do not edit\n"
+        "#include \"${headerName}\"\n\n"
+        "const uint32_t ${NAME}[] = {\n"
+        "    ${words}\n"
+        "};\n\n"
+        "const size_t ${NAME}_size = ${size};\n"
+)
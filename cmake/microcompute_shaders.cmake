@@ -0,0 +1,62 @@
+set(MC_EMBED_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/mc_embed.cmake")
+
+# mc_add_shader(<target> <name> <source> [<glslc args>...])
+#
+# Compile the GLSL compute shader <source> to SPIR-V at build time and embed
+# it in <target>. The code is available as `const uint32_t <name>[]` and
+# `const size_t <name>_size` (in bytes), declared in the generated header
+# "<name>.h":
+#
+#   mc_program_code_create_from_spirv(instance, <name>_size, (char*)<name>);
+#
+# Extra arguments are passed to glslc (e.g. `-DKEY=VALUE` or `-I<dir>`). The
+# shader is rebuilt when it, or any file it includes, changes.
+function(mc_add_shader target name source)
+    get_filename_component(source "${source}" ABSOLUTE)
+    set(dir "${CMAKE_CURRENT_BINARY_DIR}/mc_shaders/${target}")
+    set(spv "${dir}/${name}.spv")
+
+    # same defaults as the runtime compiler, see mc_instance_set_compile_options
+    set(
+            glslcArgs
+            -fshader-stage=compute --target-env=vulkan1.0 -O ${ARGN}
+            -o "${spv}" "${source}"
+    )
+
+    if(CMAKE_GENERATOR MATCHES "Ninja|Makefiles")
+        add_custom_command(
+                OUTPUT "${spv}"
+                COMMAND ${CMAKE_COMMAND} -E make_directory "${dir}"
+                COMMAND Vulkan::glslc -MD -MF "${spv}.d" ${glslcArgs}
+                DEPENDS "${source}"
+                DEPFILE "${spv}.d"
+                COMMENT "Compiling shader ${name}"
+                VERBATIM
+        )
+    else()
+        add_custom_command(
+                OUTPUT "${spv}"
+                COMMAND ${CMAKE_COMMAND} -E make_directory "${dir}"
+                COMMAND Vulkan::glslc ${glslcArgs}
+                DEPENDS "${source}"
+                COMMENT "Compiling shader ${name}"
+                VERBATIM
+        )
+    endif()
+
+    add_custom_command(
+            OUTPUT "${dir}/${name}.c" "${dir}/${name}.h"
+            COMMAND ${CMAKE_COMMAND}
+            "-DINPUT=${spv}"
+            "-DSOURCE=${dir}/${name}.c"
+            "-DHEADER=${dir}/${name}.h"
+            "-DNAME=${name}"
+            -P "${MC_EMBED_SCRIPT}"
+            DEPENDS "${spv}" "${MC_EMBED_SCRIPT}"
+            COMMENT "Embedding shader ${name}"
+            VERBATIM
+    )
+
+    target_sources(${target} PRIVATE "${dir}/${name}.c" "${dir}/${name}.h")
+    target_include_directories(${target} PRIVATE "${dir}")
+endfunction()
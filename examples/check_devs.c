@@ -29,6 +29,39 @@ int main(void) {
         mc_Device* dev = devs[i];
         printf("=== %s ===\n", mc_device_get_name(dev));
         printf("- type: %s\n", mc_device_type_to_str(mc_device_get_type(dev)));
+
+        uint32_t version = mc_device_get_api_version(dev);
+        printf("- vulkan: %d.%d\n", version >> 22, (version >> 12) & 0x3ff);
+
+        const mc_DeviceInfo* info = mc_device_get_info(dev);
+        printf("- subgroup size: %d\n", info->subgroupSize);
+        printf("- shared memory: %d bytes\n", info->maxSharedMemorySize);
+        printf(
+            "- device memory: %llu MiB\n",
+            (unsigned long long)(info->deviceLocalMemory >> 20)
+        );
+        printf(
+            "- float16: %s, float64: %s, int64: %s\n",
+            mc_device_has_features(dev, MC_DEVICE_FEATURE_FLOAT16) ? "y" : "n",
+            mc_device_has_features(dev, MC_DEVICE_FEATURE_FLOAT64) ? "y" : "n",
+            mc_device_has_features(dev, MC_DEVICE_FEATURE_INT64) ? "y" : "n"
+        );
+
+        const mc_DeviceProfile* profile = mc_device_get_profile(dev);
+        if (profile) {
+            printf(
+                "- upload: %.1f GB/s, download: %.1f GB/s, device: %.1f GB/s\n",
+                profile->uploadBandwidth * 1e-9,
+                profile->downloadBandwidth * 1e-9,
+                profile->deviceBandwidth * 1e-9
+            );
+            printf(
+                "- dispatch latency: %.1f us, %.1f GFLOPS\n",
+                profile->dispatchLatency * 1e6,
+                profile->flops * 1e-9
+            );
+        }
+
         printf("- testing (values should be doubled every iteration):\n");
 
         float arr[] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f};
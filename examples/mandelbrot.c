@@ -6,7 +6,8 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-#define SHADER_PATH "../examples/mandelbrot.glsl"
+// compiled from mandelbrot.glsl at build time, see `mc_add_shader()`
+#include "mandelbrot_spv.h"
 
 struct Opt {
     float center[2];
@@ -25,17 +26,15 @@ int main(void) {
     };
 
     mc_Instance* instance = mc_instance_create(mc_log_cb_simple, NULL);
-    mc_Device* dev = mc_instance_get_devices(instance)[0];
+    mc_Device* dev = mc_instance_select_device(instance, NULL);
 
     mc_HBuffer* optBuff = mc_hybrid_buffer_create_from(dev, sizeof opt, &opt);
     mc_HBuffer* imgBuff = mc_hybrid_buffer_create(dev, imgSize);
 
-    char* programSource = read_file(SHADER_PATH, NULL);
-    mc_ProgramCode* programCode = mc_program_code_create_from_glsl(
+    mc_ProgramCode* programCode = mc_program_code_create_from_spirv(
         instance,
-        SHADER_PATH,
-        programSource,
-        "main"
+        mandelbrot_spv_size,
+        (const char*)mandelbrot_spv
     );
     mc_Program* prog = mc_program_create(dev, programCode);
 
@@ -51,6 +50,5 @@ int main(void) {
     mc_hybrid_buffer_destroy(imgBuff);
     mc_program_destroy(prog);
     mc_program_code_destroy(programCode);
-    free(programSource);
     mc_instance_destroy(instance);
 }
\ No newline at end of file
@@ -32,14 +32,140 @@ typedef enum mc_DeviceType {
     MC_DEVICE_TYPE_OTHER, ///< other (or unknown)
 } mc_DeviceType;
 
+/**
+ * Make a mask of device types, as used by `mc_DeviceCriteria`.
+ */
+#define MC_DEVICE_TYPE_BIT(type) (1u << (type))
+
+/**
+ * Optional shader features of a device, see `mc_device_get_info()`.
+ */
+typedef enum mc_DeviceFeature {
+    MC_DEVICE_FEATURE_FLOAT16 = 1 << 0,               ///< 16 bit float math
+    MC_DEVICE_FEATURE_FLOAT64 = 1 << 1,               ///< 64 bit float math
+    MC_DEVICE_FEATURE_INT8 = 1 << 2,                  ///< 8 bit integer math
+    MC_DEVICE_FEATURE_INT16 = 1 << 3,                 ///< 16 bit integer math
+    MC_DEVICE_FEATURE_INT64 = 1 << 4,                 ///< 64 bit integer math
+    MC_DEVICE_FEATURE_STORAGE_8BIT = 1 << 5,          ///< 8 bit buffer types
+    MC_DEVICE_FEATURE_STORAGE_16BIT = 1 << 6,         ///< 16 bit buffer types
+    MC_DEVICE_FEATURE_INT64_ATOMICS = 1 << 7,         ///< 64 bit buffer atomics
+    MC_DEVICE_FEATURE_TIMELINE_SEMAPHORE = 1 << 8,    ///< Timeline semaphores
+    MC_DEVICE_FEATURE_BUFFER_DEVICE_ADDRESS = 1 << 9, ///< Buffer pointers
+    MC_DEVICE_FEATURE_SYNCHRONIZATION_2 = 1 << 10,    ///< Synchronization2
+    MC_DEVICE_FEATURE_SCALAR_BLOCK_LAYOUT = 1 << 11,  ///< Scalar block layout
+    MC_DEVICE_FEATURE_VULKAN_MEMORY_MODEL = 1 << 12,  ///< Vulkan memory model
+} mc_DeviceFeature;
+
+/**
+ * Subgroup operations supported in compute shaders (the same bits as
+ * `VkSubgroupFeatureFlagBits`).
+ */
+typedef enum mc_SubgroupOperation {
+    MC_SUBGROUP_OPERATION_BASIC = 1 << 0,
+    MC_SUBGROUP_OPERATION_VOTE = 1 << 1,
+    MC_SUBGROUP_OPERATION_ARITHMETIC = 1 << 2,
+    MC_SUBGROUP_OPERATION_BALLOT = 1 << 3,
+    MC_SUBGROUP_OPERATION_SHUFFLE = 1 << 4,
+    MC_SUBGROUP_OPERATION_SHUFFLE_RELATIVE = 1 << 5,
+    MC_SUBGROUP_OPERATION_CLUSTERED = 1 << 6,
+    MC_SUBGROUP_OPERATION_QUAD = 1 << 7,
+} mc_SubgroupOperation;
+
+/**
+ * The capabilities of a device, queried once when the instance is created.
+ */
+typedef struct mc_DeviceInfo {
+    uint32_t vendorId;                        ///< PCI vendor ID
+    uint32_t deviceId;                        ///< Vendor specific device ID
+    uint32_t driverVersion;                   ///< Vendor specific encoding
+    uint32_t apiVersion;                      ///< Vulkan version of the device
+    uint32_t subgroupSize;                    ///< 0 if unknown (Vulkan 1.0)
+    uint32_t subgroupOperations;              ///< `mc_SubgroupOperation` flags
+    uint32_t maxSharedMemorySize;             ///< Bytes of shared memory
+    uint32_t maxStorageBufferRange;           ///< Max size of a storage buffer
+    uint32_t maxUniformBufferRange;           ///< Max size of a uniform buffer
+    uint32_t maxPushConstantsSize;            ///< Max size of push constants
+    uint64_t minStorageBufferOffsetAlignment; ///< For storage buffer offsets
+    uint64_t minUniformBufferOffsetAlignment; ///< For uniform buffer offsets
+    uint64_t nonCoherentAtomSize;             ///< For flushing mapped memory
+    float timestampPeriod;                    ///< ns per tick, 0 if unsupported
+    uint64_t deviceLocalMemory;               ///< Bytes in device-local heaps
+    uint64_t hostVisibleMemory;               ///< Bytes in CPU visible heaps
+    uint32_t features;                        ///< `mc_DeviceFeature` flags
+} mc_DeviceInfo;
+
+/**
+ * The measured performance of a device, see `mc_device_get_profile()`.
+ */
+typedef struct mc_DeviceProfile {
+    double uploadBandwidth;   ///< CPU to GPU buffer copies, in bytes/s
+    double downloadBandwidth; ///< GPU to CPU buffer copies, in bytes/s
+    double deviceBandwidth;   ///< GPU to GPU buffer copies, in bytes/s
+    double dispatchLatency;   ///< Time to run an empty program, in seconds
+    double flops;             ///< 32 bit float operations per second (approx.)
+} mc_DeviceProfile;
+
+/**
+ * What a device must (and should) have, see `mc_instance_select_device()`.
+ * Zeroed fields don't restrict anything.
+ */
+typedef struct mc_DeviceCriteria {
+    uint32_t requiredTypes;    ///< `MC_DEVICE_TYPE_BIT()` mask, 0 for any
+    uint32_t preferredTypes;   ///< Ranked first if matching, 0 for none
+    uint64_t minMemory;        ///< Min bytes of device-local memory
+    uint32_t requiredFeatures; ///< `mc_DeviceFeature` flags
+    uint32_t vendorId;         ///< PCI vendor ID, 0 for any
+} mc_DeviceCriteria;
+
 /**
  * The type of a buffer.
  */
 typedef enum mc_BufferType {
     MC_BUFFER_TYPE_CPU, ///< Accessible from CPU, but slow GPU access
-    MC_BUFFER_TYPE_GPU, ///< Not accessible from CPU, but fast GPU access
+    MC_BUFFER_TYPE_GPU, ///< Fast GPU access, CPU access on unified memory
 } mc_BufferType;
 
+/**
+ * Flags for `mc_instance_create_with_flags()`, combined with `|`.
+ */
+typedef enum mc_InstanceFlags {
+    MC_INSTANCE_FLAG_NONE = 0, ///< No validation, the fastest setup
+    /// Enable the Khronos validation layer, and forward its messages to the
+    /// log callback (slows down every Vulkan call, use it for debugging)
+    MC_INSTANCE_FLAG_VALIDATION = 1 << 0,
+} mc_InstanceFlags;
+
+/**
+ * Make a Vulkan version number, as used by `mc_CompileOptions`.
+ */
+#define MC_VULKAN_VERSION(major, minor)                                        \
+    (((uint32_t)(major) << 22) | ((uint32_t)(minor) << 12))
+
+/**
+ * Make a SPIR-V version number, as used by `mc_CompileOptions`.
+ */
+#define MC_SPIRV_VERSION(major, minor)                                         \
+    (((uint32_t)(major) << 16) | ((uint32_t)(minor) << 8))
+
+/**
+ * How much the shader compiler optimizes code.
+ */
+typedef enum mc_OptimizationLevel {
+    MC_OPTIMIZATION_LEVEL_NONE,        ///< No optimization, fastest compiles
+    MC_OPTIMIZATION_LEVEL_SIZE,        ///< Optimize for code size
+    MC_OPTIMIZATION_LEVEL_PERFORMANCE, ///< Optimize for performance
+} mc_OptimizationLevel;
+
+/**
+ * Options for compiling GLSL code, see `mc_instance_set_compile_options()`.
+ */
+typedef struct mc_CompileOptions {
+    uint32_t vulkanVersion; ///< Target Vulkan version (`MC_VULKAN_VERSION()`)
+    uint32_t spirvVersion;  ///< SPIR-V version, 0 for the Vulkan default
+    mc_OptimizationLevel optimizationLevel; ///< The optimization level
+    bool debugInfo; ///< Generate debug information (names, source lines)
+} mc_CompileOptions;
+
 /**
  * Options to pass to mc_program_code_create_*.
  */
@@ -48,6 +174,25 @@ typedef struct mc_CompileDefinition {
     char* value; ///< The value
 } mc_CompileDefinition;
 
+/**
+ * The type of a descriptor binding used by some program code.
+ */
+typedef enum mc_BindingType {
+    MC_BINDING_TYPE_STORAGE_BUFFER, ///< A storage buffer (`buffer` block)
+    MC_BINDING_TYPE_UNIFORM_BUFFER, ///< A uniform buffer (`uniform` block)
+    MC_BINDING_TYPE_OTHER,          ///< An image, sampler, ... (unsupported)
+} mc_BindingType;
+
+/**
+ * A descriptor binding used by some program code, found in its SPIR-V.
+ */
+typedef struct mc_Binding {
+    uint32_t set;        ///< The descriptor set
+    uint32_t binding;    ///< The binding number
+    mc_BindingType type; ///< The type of the binding
+    uint32_t count;      ///< The array size, 1 if not an array, 0 if unsized
+} mc_Binding;
+
 /**
  * The log callback type.
  * @param arg The value passed to `logArg` in `mc_instance_create()`
@@ -99,8 +244,30 @@ typedef struct mc_ProgramCode mc_ProgramCode;
 typedef struct mc_Program mc_Program;
 
 /**
- * Create an instance of the library. If `log_fn` is `NULL`, no logs will be
- * from microcompute.
+ * A family of variants of some GLSL code, one per set of definitions.
+ */
+typedef struct mc_ProgramFamily mc_ProgramFamily;
+
+/**
+ * Recompiles GLSL files in the background when they (or their includes) change.
+ */
+typedef struct mc_ShaderWatcher mc_ShaderWatcher;
+
+/**
+ * A compilation job, used by `mc_program_code_create_batch()`.
+ */
+typedef struct mc_CompileJob {
+    const char* name;           ///< The name of the code
+    const char* code;           ///< The GLSL code
+    const char* entry;          ///< The entry point
+    mc_CompileDefinition* defs; ///< Definitions, `{NULL, NULL}` ended
+    mc_ProgramCode* result;     ///< The result, `NULL` on error
+    char* diagnostics;          ///< Compiler messages, or `NULL`
+} mc_CompileJob;
+
+/**
+ * Create an instance of the library, without validation. If `log_fn` is
+ * `NULL`, no logs will be from microcompute.
  *
  * @param log_fn A function to call when there is a message from the library
  * @param logArg A value to pass to the `arg` parameter of `log_fn`
@@ -108,6 +275,22 @@ typedef struct mc_Program mc_Program;
  */
 mc_Instance* mc_instance_create(mc_log_fn* log_fn, void* logArg);
 
+/**
+ * Create an instance of the library with some flags. If validation is asked
+ * for but the validation layer is not installed, a warning is logged and the
+ * instance is created without it.
+ *
+ * @param log_fn A function to call when there is a message from the library
+ * @param logArg A value to pass to the `arg` parameter of `log_fn`
+ * @param flags A combination of `mc_InstanceFlags`
+ * @return A new instance success, `NULL` on error
+ */
+mc_Instance* mc_instance_create_with_flags(
+    mc_log_fn* log_fn,
+    void* logArg,
+    uint32_t flags
+);
+
 /**
  * Destroy an instance of the library.
  * @param instance An instance of the library
@@ -122,12 +305,94 @@ void mc_instance_destroy(mc_Instance* instance);
 uint32_t mc_instance_get_device_count(mc_Instance* instance);
 
 /**
- * Get the devices available to an instance.
+ * Get the devices available to an instance. Only the properties of a device
+ * are queried up front, the device itself is opened when the first buffer or
+ * program is created on it, so unused devices cost nothing.
+ *
  * @param instance A n instance of the library
  * @return An array of devices
  */
 mc_Device** mc_instance_get_devices(mc_Instance* instance);
 
+/**
+ * Get the devices matching some criteria, ranked by their expected throughput:
+ * devices of a preferred type first, then discrete, integrated, virtual and
+ * other GPUs, and CPUs last, with more device memory ranking higher within
+ * a type.
+ *
+ * @param instance An instance of the library
+ * @param criteria The criteria, `NULL` to rank all devices
+ * @param devs An array with space for `mc_instance_get_device_count()` devices,
+ * filled with the matching devices, best first
+ * @return The number of matching devices
+ */
+uint32_t mc_instance_select_devices(
+    mc_Instance* instance,
+    const mc_DeviceCriteria* criteria,
+    mc_Device** devs
+);
+
+/**
+ * Get the best device matching some criteria, see
+ * `mc_instance_select_devices()`.
+ *
+ * @param instance An instance of the library
+ * @param criteria The criteria, `NULL` to pick the best device
+ * @return The best matching device, `NULL` if there is none
+ */
+mc_Device* mc_instance_select_device(
+    mc_Instance* instance,
+    const mc_DeviceCriteria* criteria
+);
+
+/**
+ * Set the directory used to cache compiled shaders. Compiled SPIR-V is stored
+ * there under a hash of everything that affects the compilation (source,
+ * entry point, definitions, compiler options and version), and reused by
+ * later compilations, also across processes. Device profiles (see
+ * `mc_device_get_profile()`) are stored there as well. The directory is
+ * created if it does not exist. Pass `NULL` to disable caching (the default).
+ *
+ * @param instance An instance of the library
+ * @param dir The cache directory, copied internally, or `NULL`
+ */
+void mc_instance_set_cache_dir(mc_Instance* instance, const char* dir);
+
+/**
+ * Set the options used to compile GLSL code, for all later compilations. The
+ * defaults are Vulkan 1.0, the default SPIR-V version and
+ * `MC_OPTIMIZATION_LEVEL_PERFORMANCE`, without debug information. Targeting a
+ * newer Vulkan version enables e.g. subgroup operations, but the code can only
+ * be used on devices that support that version.
+ *
+ * @param instance An instance of the library
+ * @param options The options, or `NULL` to restore the defaults
+ * @return `true` on success, `false` if the options are not supported
+ */
+bool mc_instance_set_compile_options(
+    mc_Instance* instance,
+    const mc_CompileOptions* options
+);
+
+/**
+ * Get the options used to compile GLSL code.
+ * @param instance An instance of the library
+ * @return The current options
+ */
+mc_CompileOptions mc_instance_get_compile_options(mc_Instance* instance);
+
+/**
+ * Add a directory to search for files included with `#include` in GLSL code.
+ * `#include "file"` is first looked up next to the including file, then in
+ * the include paths; `#include <file>` is only looked up in the include paths.
+ * Paths are searched in the order they were added. Add all include paths
+ * before compiling any code.
+ *
+ * @param instance An instance of the library
+ * @param path The directory to add, copied internally
+ */
+void mc_instance_add_include_path(mc_Instance* instance, const char* path);
+
 /**
  * Get the type of a device.
  * @param device A device
@@ -163,6 +428,66 @@ uint32_t* mc_device_get_max_workgroup_count(mc_Device* device);
  */
 char* mc_device_get_name(mc_Device* device);
 
+/**
+ * Get the number of compute queues of a device. All of them are opened with
+ * the device, see `mc_program_set_queue()`.
+ *
+ * @param device A device
+ * @return The number of queues
+ */
+uint32_t mc_device_get_queue_count(mc_Device* device);
+
+/**
+ * Get the capabilities of a device: limits, memory sizes, subgroup support and
+ * optional features. All of the supported features are enabled when the device
+ * is opened, so shaders can use them right away.
+ *
+ * @param device A device
+ * @return The capabilities of the device, `NULL` on error
+ */
+const mc_DeviceInfo* mc_device_get_info(mc_Device* device);
+
+/**
+ * Check if a device supports some optional features.
+ * @param device A device
+ * @param features A combination of `mc_DeviceFeature` flags
+ * @return `true` if all of the features are supported, `false` otherwise
+ */
+bool mc_device_has_features(mc_Device* device, uint32_t features);
+
+/**
+ * Check if the memory of a device is shared with the CPU (integrated GPUs and
+ * CPU devices such as lavapipe). `MC_BUFFER_TYPE_GPU` buffers of such devices
+ * are mapped, so they can be read and written directly, and hybrid buffers
+ * use a single allocation with no copies.
+ *
+ * @param device A device
+ * @return `true` if the memory is unified, `false` otherwise
+ */
+bool mc_device_has_unified_memory(mc_Device* device);
+
+/**
+ * Get the Vulkan version the library uses for a device, the highest version
+ * (up to 1.3) supported by both the device and the loader. Features that are
+ * core in later versions are enabled through extensions when available.
+ *
+ * @param device A device
+ * @return The version (`MC_VULKAN_VERSION()`), 0 on error
+ */
+uint32_t mc_device_get_api_version(mc_Device* device);
+
+/**
+ * Get the measured performance of a device. The first call runs a short
+ * calibration (a few copies and tiny programs, usually well under a second)
+ * unless a profile of the same device and driver version is found in the
+ * cache directory (see `mc_instance_set_cache_dir()`), where the results are
+ * stored for later runs.
+ *
+ * @param device A device
+ * @return The performance of the device, `NULL` on error
+ */
+const mc_DeviceProfile* mc_device_get_profile(mc_Device* device);
+
 /**
  * Create an empty buffer.
  * @param device A device
@@ -190,7 +515,29 @@ void mc_buffer_destroy(mc_Buffer* buffer);
 uint64_t mc_buffer_get_size(mc_Buffer* buffer);
 
 /**
- * Write data to a buffer. Must be of type `MC_BUFFER_TYPE_CPU`.
+ * Get the GPU address of a buffer, to pass it to a program through push
+ * constants or another buffer instead of binding it, so switching buffers
+ * doesn't rebuild any descriptors. Shaders follow it with
+ * `GL_EXT_buffer_reference`:
+ *
+ * ```glsl
+ * layout(buffer_reference, std430) buffer Data { float values[]; };
+ * layout(push_constant) uniform Push { Data data; };
+ * ```
+ *
+ * The address stays valid until the buffer is destroyed. A hybrid buffer can
+ * be cast to `mc_Buffer*` to get the address of its GPU side. Needs
+ * `MC_DEVICE_FEATURE_BUFFER_DEVICE_ADDRESS`.
+ *
+ * @param buffer A buffer
+ * @return The address of the buffer, 0 on error
+ */
+uint64_t mc_buffer_get_device_address(mc_Buffer* buffer);
+
+/**
+ * Write data to a buffer. Must be of type `MC_BUFFER_TYPE_CPU`, or belong to a
+ * device with unified memory (see `mc_device_has_unified_memory()`).
+ *
  * @param buffer A buffer
  * @param offset The offset from witch to start writing the data, in bytes
  * @param size The size of the data to write, in bytes
@@ -205,7 +552,9 @@ uint64_t mc_buffer_write(
 );
 
 /**
- * Read data from a buffer. Must be of type `MC_BUFFER_TYPE_CPU`.
+ * Read data from a buffer. Must be of type `MC_BUFFER_TYPE_CPU`, or belong to a
+ * device with unified memory (see `mc_device_has_unified_memory()`).
+ *
  * @param buffer A buffer
  * @param offset The offset from witch to start reading the data, in bytes
  * @param size The size of the data to read, in bytes
@@ -219,6 +568,47 @@ uint64_t mc_buffer_read(
     void* data
 );
 
+/**
+ * Fill a range of a buffer with a repeated 32 bit value on the device, without
+ * any host memory or staging buffers. Works on any type of buffer (including
+ * hybrid buffers).
+ *
+ * @param buffer A buffer
+ * @param offset The offset from witch to start filling, in bytes (must be a
+ * multiple of 4)
+ * @param size The number of bytes to fill (must be a multiple of 4, unless the
+ * range ends at the end of the buffer, then the last 1 to 3 bytes are left
+ * as they are)
+ * @param data The value to fill the buffer with
+ * @return The number of bytes filled, 0 on error
+ */
+uint64_t mc_buffer_fill(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    uint32_t data
+);
+
+/**
+ * Update a small range of a buffer on the device. The data is recorded inline
+ * in the command stream, so no staging buffer is used. Works on any type of
+ * buffer (including hybrid buffers).
+ *
+ * @param buffer A buffer
+ * @param offset The offset from witch to start writing the data, in bytes
+ * (must be a multiple of 4)
+ * @param size The size of the data to write, in bytes (must be a multiple of
+ * 4, and at most 65536)
+ * @param data A reference to the data to write
+ * @return The number of bytes written, 0 on error
+ */
+uint64_t mc_buffer_update(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    void* data
+);
+
 /**
  * Create a buffer copier.
  * @param device A device
@@ -232,6 +622,16 @@ mc_BufferCopier* mc_buffer_copier_create(mc_Device* device);
  */
 void mc_buffer_copier_destroy(mc_BufferCopier* copier);
 
+/**
+ * Set the queue a buffer copier submits to (queue 0 by default). Copies on
+ * different queues can run at the same time.
+ *
+ * @param copier A buffer copier
+ * @param queue The queue, less than `mc_device_get_queue_count()`
+ * @return `true` on success, `false` on error
+ */
+bool mc_buffer_copier_set_queue(mc_BufferCopier* copier, uint32_t queue);
+
 /**
  * Copy data from one buffer to another.
  * @param copier A buffer copier
@@ -252,7 +652,9 @@ uint64_t mc_buffer_copier_copy(
 );
 
 /**
- * Create some program code from SPIR-V code.
+ * Create some program code from SPIR-V code. The first compute entry point in
+ * the code is used.
+ *
  * @param instance A instance
  * @param size The size of the code
  * @param code The code contens, copied internaly
@@ -265,7 +667,27 @@ mc_ProgramCode* mc_program_code_create_from_spirv(
 );
 
 /**
- * Create some program code from GLSL code.
+ * Create some program code from a SPIR-V file. The file is mapped read-only
+ * instead of copied, so loading many modules is cheap; it should not be
+ * modified while the program code exists. The first compute entry point in the
+ * code is used. The file has to be a regular file, pipes aren't supported.
+ *
+ * @param instance A instance
+ * @param path The path of the SPIR-V file
+ * @return New program code on success, `NULL` on error
+ */
+mc_ProgramCode* mc_program_code_create_from_spirv_file(
+    mc_Instance* instance,
+    const char* path
+);
+
+/**
+ * Create some program code from GLSL code. The shader compiler is created on
+ * first use and shared by the instance, and this can be called from multiple
+ * threads at once. Always fails if the library was built without
+ * `MC_WITH_SHADERC`, use `mc_add_shader()` in CMake to compile shaders at build
+ * time instead.
+ *
  * @param instance A instance
  * @param name The name of the code (used in compile error messages)
  * @param code The code contens, copied internaly
@@ -283,10 +705,100 @@ mc_ProgramCode* mc_program_code_create_from_spirv(
         (mc_CompileDefinition){NULL, NULL}                                     \
     )
 
+/**
+ * Compile many pieces of GLSL code in parallel, on a pool of worker threads
+ * sized to the number of CPU cores. For every job, `result` is set to the new
+ * program code (`NULL` on error) and `diagnostics` to the compiler errors and
+ * warnings, if any (free it with `free()`).
+ *
+ * @param instance A instance
+ * @param jobCount The number of jobs
+ * @param jobs The jobs to compile
+ * @return The number of jobs that compiled successfully
+ */
+uint32_t mc_program_code_create_batch(
+    mc_Instance* instance,
+    uint32_t jobCount,
+    mc_CompileJob* jobs
+);
+
+/**
+ * Get the number of files included by some program code.
+ * @param programCode Program code
+ * @return The number of included files
+ */
+uint32_t mc_program_code_get_dependency_count(mc_ProgramCode* programCode);
+
+/**
+ * Get the paths of the files included by some program code (directly or
+ * indirectly), as resolved when it was compiled.
+ *
+ * @param programCode Program code
+ * @return An array of paths
+ */
+char** mc_program_code_get_dependencies(mc_ProgramCode* programCode);
+
+/**
+ * Get the number of descriptor bindings used by some program code.
+ * @param programCode Program code
+ * @return The number of bindings
+ */
+uint32_t mc_program_code_get_binding_count(mc_ProgramCode* programCode);
+
+/**
+ * Get the descriptor bindings used by some program code, sorted by set and
+ * binding number.
+ *
+ * @param programCode Program code
+ * @return An array of bindings
+ */
+mc_Binding* mc_program_code_get_bindings(mc_ProgramCode* programCode);
+
+/**
+ * Get the local size (workgroup size) of the entry point of some program code.
+ * The number of invocations in a dimension is the dimension passed to
+ * `mc_program_run()` times the local size in that dimension. Specializable
+ * local sizes are reported with their default values.
+ *
+ * @param programCode Program code
+ * @return An array of 3 sizes (x, y, z)
+ */
+uint32_t* mc_program_code_get_local_size(mc_ProgramCode* programCode);
+
+/**
+ * Get the size of the push constant block of some program code.
+ * @param programCode Program code
+ * @return The size in bytes, 0 if the code has no push constants
+ */
+uint32_t mc_program_code_get_push_constant_size(mc_ProgramCode* programCode);
+
+/**
+ * Get the number of specialization constants of some program code.
+ * @param programCode Program code
+ * @return The number of specialization constants
+ */
+uint32_t mc_program_code_get_spec_constant_count(mc_ProgramCode* programCode);
+
+/**
+ * Get the IDs (`constant_id`) of the specialization constants of some program
+ * code, in ascending order.
+ *
+ * @param programCode Program code
+ * @return An array of IDs
+ */
+uint32_t* mc_program_code_get_spec_constant_ids(mc_ProgramCode* programCode);
+
+/**
+ * Destroy some program code.
+ * @param programCode Program code
+ */
 void mc_program_code_destroy(mc_ProgramCode* programCode);
 
 /**
- * Create a program from some SPIRV code.
+ * Create a program from some SPIRV code. The layout of the program is built
+ * from the bindings and push constants used by the code, only storage and
+ * uniform buffers in descriptor set 0 are supported.
+ *
  * @param device A device
  * @param code The shader code
  * @return A new program on success, `NULL` on error
@@ -299,18 +811,166 @@ mc_Program* mc_program_create(mc_Device* device, mc_ProgramCode* code);
  */
 void mc_program_destroy(mc_Program* program);
 
+/**
+ * Replace the code of a program. The new pipeline is built right away (this
+ * can be called from another thread while the program is running) and swapped
+ * in before the next run of the program. Push constants are kept as far as
+ * they fit in the new code. The code can be destroyed once this returns.
+ *
+ * @param program A program
+ * @param code The new code
+ * @return `true` on success, `false` on error (the old code is kept)
+ */
+bool mc_program_set_code(mc_Program* program, mc_ProgramCode* code);
+
+/**
+ * Set the queue a program runs on (queue 0 by default). Programs on different
+ * queues, run from different threads, can run at the same time.
+ *
+ * @param program A program
+ * @param queue The queue, less than `mc_device_get_queue_count()`
+ * @return `true` on success, `false` on error
+ */
+bool mc_program_set_queue(mc_Program* program, uint32_t queue);
+
+/**
+ * Set the push constants of a program, used by the following runs. Push
+ * constants are zero until they are set.
+ *
+ * @param program A program
+ * @param size The size of the data, at most the push constant size of the code
+ * @param data A reference to the data
+ * @return The number of bytes set, 0 on error
+ */
+uint32_t mc_program_set_push_constants(
+    mc_Program* program,
+    uint32_t size,
+    const void* data
+);
+
 /**
  * Run a program.
  * @param program A program
  * @param dimX The number of workgroups to run in the x direction
  * @param dimY The number of workgroups to run in the y direction
  * @param dimZ The number of workgroups to run in the z direction
- * @param ... Buffers / hybrid buffers to pass to the program
+ * @param ... Buffers / hybrid buffers to pass to the program, the n-th buffer
+ *            is bound to binding n (of set 0)
  * @return The time taken to run the program, in seconds
  */
 #define mc_program_run(program, dimX, dimY, dimZ, ...)                         \
     mc_program_run__(program, dimX, dimY, dimZ, ##__VA_ARGS__, NULL)
 
+/**
+ * Create a program family: GLSL code whose variants (the code compiled with
+ * different definitions) are compiled on first use. Each variant is compiled
+ * at most once, and its program code and programs are kept until the family
+ * is destroyed. The family can be used from multiple threads at once.
+ *
+ * @param instance A instance
+ * @param name The name of the code (used in compile error messages)
+ * @param code The code contents, copied internally
+ * @param entry The entry point (the name of the "main" function)
+ * @return A new program family on success, `NULL` on error
+ */
+mc_ProgramFamily* mc_program_family_create(
+    mc_Instance* instance,
+    const char* name,
+    const char* code,
+    const char* entry
+);
+
+/**
+ * Destroy a program family, and the program code and programs of all of its
+ * variants.
+ *
+ * @param family A program family
+ */
+void mc_program_family_destroy(mc_ProgramFamily* family);
+
+/**
+ * Get the number of variants of a program family used so far.
+ * @param family A program family
+ * @return The number of variants
+ */
+uint32_t mc_program_family_get_variant_count(mc_ProgramFamily* family);
+
+/**
+ * Get the program code of a variant of a program family, compiling it on first
+ * use. The order of the definitions does not matter. The program code belongs
+ * to the family, do not destroy it.
+ *
+ * @param family A program family
+ * @param ... Any compile-time definitions (#define's)
+ * @return The program code on success, `NULL` on error
+ */
+#define mc_program_family_get_code(family, ...)                                \
+    mc_program_family_get_code__(                                              \
+        family,                                                                \
+        ##__VA_ARGS__,                                                         \
+        (mc_CompileDefinition){NULL, NULL}                                     \
+    )
+
+/**
+ * Get a program for a variant of a program family on a device, compiling the
+ * variant and creating the program on first use. The program belongs to the
+ * family, do not destroy it.
+ *
+ * @param family A program family
+ * @param device A device
+ * @param ... Any compile-time definitions (#define's)
+ * @return The program on success, `NULL` on error
+ */
+#define mc_program_family_get_program(family, device, ...)                     \
+    mc_program_family_get_program__(                                           \
+        family,                                                                \
+        device,                                                                \
+        ##__VA_ARGS__,                                                         \
+        (mc_CompileDefinition){NULL, NULL}                                     \
+    )
+
+/**
+ * Create a shader watcher, which checks the files added to it on a background
+ * thread and gives the programs new code (see `mc_program_set_code()`) when a
+ * file or one of its includes changes. Changes are noticed through inotify on
+ * Linux, elsewhere the files are polled. This is meant for development, code
+ * that fails to compile is logged and the old code is kept.
+ *
+ * @param instance A instance
+ * @return A new shader watcher on success, `NULL` on error
+ */
+mc_ShaderWatcher* mc_shader_watcher_create(mc_Instance* instance);
+
+/**
+ * Destroy a shader watcher. It must be destroyed before the programs it
+ * watches.
+ *
+ * @param watcher A shader watcher
+ */
+void mc_shader_watcher_destroy(mc_ShaderWatcher* watcher);
+
+/**
+ * Compile a GLSL file for a program and keep the program in sync with it. The
+ * file is compiled right away, and the new code is used from the next run of
+ * the program.
+ *
+ * @param watcher A shader watcher
+ * @param program The program to update
+ * @param path The path of the GLSL file
+ * @param entry The entry point (the name of the "main" function)
+ * @param ... Any compile-time definitions (#define's)
+ * @return `true` on success, `false` on error
+ */
+#define mc_shader_watcher_add(watcher, program, path, entry, ...)              \
+    mc_shader_watcher_add__(                                                   \
+        watcher,                                                               \
+        program,                                                               \
+        path,                                                                  \
+        entry,                                                                 \
+        ##__VA_ARGS__,                                                         \
+        (mc_CompileDefinition){NULL, NULL}                                     \
+    )
+
 /**
  * Get the current time.
  * @return The current time in seconds
@@ -359,6 +1019,22 @@ mc_ProgramCode* mc_program_code_create_from_glsl__(
 /**
  * For internal use
  */
+mc_ProgramCode* mc_program_family_get_code__(mc_ProgramFamily* family, ...);
+
+mc_Program* mc_program_family_get_program__(
+    mc_ProgramFamily* family,
+    mc_Device* device,
+    ...
+);
+
+bool mc_shader_watcher_add__(
+    mc_ShaderWatcher* watcher,
+    mc_Program* program,
+    const char* path,
+    const char* entry,
+    ...
+);
+
 double mc_program_run__(
     mc_Program* program,
     uint32_t dimX,
@@ -23,12 +23,74 @@ typedef struct mc_Buffer mc_Buffer;
  */
 typedef struct mc_Program mc_Program;
 
+/**
+ * Compiled program code, not bound to a device.
+ */
+typedef struct mc_ProgramCode mc_ProgramCode;
+
 /**
  * A hybrid buffer. This buffer is can be accessed from the CPU while still
- * being fast to access from the GPU.
+ * being fast to access from the GPU. On devices with unified memory it is a
+ * single mapped allocation, and reads and writes are plain memory copies.
  */
 typedef struct mc_HBuffer mc_HBuffer;
 
+/**
+ * A range of a hybrid buffer, used to read or write many hybrid buffers at
+ * once.
+ */
+typedef struct mc_HBufferRange {
+    mc_HBuffer* hBuffer; ///< The hybrid buffer
+    uint64_t offset;     ///< The offset of the range, in bytes
+    uint64_t size;       ///< The size of the range, in bytes
+    void* data;          ///< The data to write / where to read the data into
+} mc_HBufferRange;
+
+/**
+ * A streaming executor. Splits an input into chunks and runs a program on them
+ * while the neighbouring chunks are uploaded and downloaded.
+ */
+typedef struct mc_Stream mc_Stream;
+
+/**
+ * A program running on several devices at once. Every run is split between
+ * the devices in proportion to how fast they ran the previous ones.
+ */
+typedef struct mc_MultiProgram mc_MultiProgram;
+
+/**
+ * A buffer of a multi-device program, with a copy on every device.
+ */
+typedef struct mc_MultiBuffer mc_MultiBuffer;
+
+/**
+ * The stream input callback type, called to produce a chunk of input.
+ * @param arg The value passed to `arg` in `mc_stream_run()`
+ * @param idx The index of the chunk
+ * @param size The size of the chunk, in bytes
+ * @param data Where to write the chunk (mapped staging memory)
+ */
+typedef void(mc_stream_in_fn)( //
+    void* arg,
+    uint64_t idx,
+    uint64_t size,
+    void* data
+);
+
+/**
+ * The stream output callback type, called once for every chunk, in order.
+ * @param arg The value passed to `arg` in `mc_stream_run()`
+ * @param idx The index of the chunk
+ * @param size The size of the chunk, in bytes
+ * @param data The result of the chunk (mapped staging memory)
+ */
+typedef void(mc_stream_out_fn)( //
+    void* arg,
+    uint64_t idx,
+    uint64_t size,
+    const void* data
+);
+
 /**
  * Create an empty hybrid buffer.
  * @param device A device
@@ -50,6 +112,21 @@ mc_HBuffer* mc_hybrid_buffer_create_from(
     void* data
 );
 
+/**
+ * Create a hybrid buffer from the contents of a file. The file is read in
+ * chunks straight into the mapped memory of the buffer, and each chunk is
+ * copied to the GPU while the next one is being read. On devices with unified
+ * memory the whole file is read in place.
+ *
+ * @param device A device
+ * @param filename The name of the file to read
+ * @return An new hybrid buffer on success, `NULL` on error
+ */
+mc_HBuffer* mc_hybrid_buffer_create_from_file(
+    mc_Device* device,
+    const char* filename
+);
+
 /**
  * Destroy a hybrid buffer.
  * @param hBuffer A hybrid buffer
@@ -93,6 +170,28 @@ uint64_t mc_hybrid_buffer_read(
     void* data
 );
 
+/**
+ * Write to many hybrid buffers at once. All copies are recorded into a single
+ * command buffer and waited on once, instead of one round trip per buffer. All
+ * hybrid buffers must belong to the same device.
+ *
+ * @param count The number of ranges
+ * @param ranges The ranges to write, and the data to write to them
+ * @return The total number of bytes written, 0 on error
+ */
+uint64_t mc_hybrid_buffer_write_many(uint32_t count, mc_HBufferRange* ranges);
+
+/**
+ * Read from many hybrid buffers at once. All copies are recorded into a single
+ * command buffer and waited on once, instead of one round trip per buffer. All
+ * hybrid buffers must belong to the same device.
+ *
+ * @param count The number of ranges
+ * @param ranges The ranges to read, and where to read the data into
+ * @return The total number of bytes read, 0 on error
+ */
+uint64_t mc_hybrid_buffer_read_many(uint32_t count, mc_HBufferRange* ranges);
+
 /**
  * Create an buffer from some data.
  * @param device A device
@@ -108,6 +207,59 @@ mc_Buffer* mc_buffer_create_from(
     void* data
 );
 
+/**
+ * Load the contents of a file into a buffer. For `MC_BUFFER_TYPE_GPU` buffers
+ * the file is streamed through small staging buffers, reading the next chunk
+ * while the previous one is being copied, so the whole file is never held in
+ * host memory.
+ *
+ * @param buffer A buffer
+ * @param offset The offset from witch to start writing the data, in bytes
+ * @param filename The name of the file to read
+ * @return The number of bytes loaded, 0 on error
+ */
+uint64_t mc_buffer_load_file(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    const char* filename
+);
+
+/**
+ * Write the contents of a buffer to a file descriptor. For
+ * `MC_BUFFER_TYPE_GPU` buffers (and hybrid buffers) the data is read back
+ * through small staging buffers, writing each chunk while the next one is
+ * being copied, so no full-size host copy is ever made.
+ *
+ * @param buffer A buffer
+ * @param offset The offset from witch to start reading the data, in bytes
+ * @param size The size of the data to write, in bytes
+ * @param fd A file descriptor open for writing
+ * @return The number of bytes written, 0 on error
+ */
+uint64_t mc_buffer_save_fd(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    int fd
+);
+
+/**
+ * Write the contents of a buffer to a file, see `mc_buffer_save_fd()`. The
+ * file is created if needed, and truncated otherwise.
+ *
+ * @param buffer A buffer
+ * @param offset The offset from witch to start reading the data, in bytes
+ * @param size The size of the data to write, in bytes
+ * @param filename The name of the file to write
+ * @return The number of bytes written, 0 on error
+ */
+uint64_t mc_buffer_save_file(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    const char* filename
+);
+
 /**
  * Reallocate a buffer. If the buffer is of type `MC_BUFFER_TYPE_CPU`, the data
  * will be copied.
@@ -126,6 +278,214 @@ mc_Buffer* mc_buffer_realloc(mc_Buffer* buffer, uint64_t size);
  */
 mc_HBuffer* mc_hybrid_buffer_realloc(mc_HBuffer* hBuffer, uint64_t size);
 
+/**
+ * Create a streaming executor. The program is run once per chunk, with the
+ * input chunk bound to binding 0 and the output chunk bound to binding 1.
+ *
+ * @param program A program
+ * @param inChunkSize The size of an input chunk, in bytes
+ * @param outChunkSize The size of an output chunk, in bytes
+ * @param depth The number of chunks in flight (at least 2, 3 to overlap the
+ * upload, execution and download of consecutive chunks)
+ * @return A new stream on success, `NULL` on error
+ */
+mc_Stream* mc_stream_create(
+    mc_Program* program,
+    uint64_t inChunkSize,
+    uint64_t outChunkSize,
+    uint32_t depth
+);
+
+/**
+ * Destroy a streaming executor.
+ * @param stream A stream
+ */
+void mc_stream_destroy(mc_Stream* stream);
+
+/**
+ * Run a program over a series of chunks. Chunk N + 1 is uploaded while chunk N
+ * is being executed and chunk N - 1 is being downloaded. If a run fails and
+ * the stream can't recover, every later run fails too, and the stream has to
+ * be recreated.
+ *
+ * @param stream A stream
+ * @param chunkCount The number of chunks to process
+ * @param dimX The number of workgroups to run in the x direction, per chunk
+ * @param dimY The number of workgroups to run in the y direction, per chunk
+ * @param dimZ The number of workgroups to run in the z direction, per chunk
+ * @param in_fn A function that produces the input chunks
+ * @param out_fn A function that consumes the output chunks
+ * @param arg A value to pass to the `arg` parameter of `in_fn` and `out_fn`
+ * @return The time taken to process all chunks, in seconds, -1 on error
+ */
+double mc_stream_run(
+    mc_Stream* stream,
+    uint64_t chunkCount,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    mc_stream_in_fn* in_fn,
+    mc_stream_out_fn* out_fn,
+    void* arg
+);
+
+/**
+ * Get the steady-state throughput of the last run of a stream, measured after
+ * the first chunk has completed (so the pipeline fill is not included).
+ *
+ * @param stream A stream
+ * @return The throughput, in input bytes per second
+ */
+double mc_stream_get_throughput(mc_Stream* stream);
+
+/**
+ * Create a program that runs on several devices. The code must start its push
+ * constants with the workgroup offset of the part of the range a device runs,
+ * and add it to `gl_WorkGroupID`:
+ *
+ * ```glsl
+ * layout(push_constant) uniform Push { uvec3 workgroupOffset; };
+ * uvec3 group = gl_WorkGroupID + workgroupOffset;
+ * ```
+ *
+ * @param devCount The number of devices
+ * @param devs The devices to run on, see `mc_instance_select_devices()`
+ * @param code The code of the program
+ * @return A new multi-device program on success, `NULL` on error
+ */
+mc_MultiProgram* mc_multi_program_create(
+    uint32_t devCount,
+    mc_Device** devs,
+    mc_ProgramCode* code
+);
+
+/**
+ * Destroy a multi-device program. Its buffers must be destroyed first.
+ * @param multi A multi-device program
+ */
+void mc_multi_program_destroy(mc_MultiProgram* multi);
+
+/**
+ * Get the number of devices of a multi-device program.
+ * @param multi A multi-device program
+ * @return The number of devices
+ */
+uint32_t mc_multi_program_get_device_count(mc_MultiProgram* multi);
+
+/**
+ * Get the part of the last run given to a device.
+ * @param multi A multi-device program
+ * @param idx The index of the device
+ * @return The share of the workgroups, between 0 and 1
+ */
+double mc_multi_program_get_share(mc_MultiProgram* multi, uint32_t idx);
+
+/**
+ * Set the push constants of a multi-device program on every device. The first
+ * 12 bytes are overwritten by the workgroup offset on every run.
+ *
+ * @param multi A multi-device program
+ * @param size The number of bytes to set
+ * @param data The values of the push constants
+ * @return The number of bytes set, 0 on error
+ */
+uint32_t mc_multi_program_set_push_constants(
+    mc_MultiProgram* multi,
+    uint32_t size,
+    const void* data
+);
+
+/**
+ * Run a multi-device program over a 1D or 2D range of workgroups. The range is
+ * split along y if `dimY` > 1, along x otherwise, in proportion to the
+ * throughput measured on the previous runs (equal parts on the first one).
+ * The devices run in parallel, and a device that gets no part is skipped.
+ *
+ * @param multi A multi-device program
+ * @param dimX The number of workgroups to run in the x direction
+ * @param dimY The number of workgroups to run in the y direction
+ * @param dimZ The number of workgroups to run in the z direction
+ * @param ... The multi-device buffers to bind, in binding order
+ * @return The time taken to run the program on all devices, in seconds, -1 on
+ * error
+ */
+#define mc_multi_program_run(multi, dimX, dimY, dimZ, ...)                     \
+    mc_multi_program_run__(multi, dimX, dimY, dimZ, ##__VA_ARGS__, NULL)
+
+double mc_multi_program_run__(
+    mc_MultiProgram* multi,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    ...
+);
+
+/**
+ * Create a buffer for a multi-device program, with a copy on every device.
+ * Buffers with a slice size are split like the range: slice N holds the data
+ * of workgroup row N (column N for 1D ranges), and is read back from the
+ * device that ran it.
+ *
+ * @param multi A multi-device program
+ * @param size The size of the buffer, in bytes
+ * @param sliceSize The size of a slice, in bytes, 0 for a buffer that is the
+ * same on every device (inputs, parameters)
+ * @return A new multi-device buffer on success, `NULL` on error
+ */
+mc_MultiBuffer* mc_multi_buffer_create(
+    mc_MultiProgram* multi,
+    uint64_t size,
+    uint64_t sliceSize
+);
+
+/**
+ * Destroy a multi-device buffer.
+ * @param mBuffer A multi-device buffer
+ */
+void mc_multi_buffer_destroy(mc_MultiBuffer* mBuffer);
+
+/**
+ * Get the size of a multi-device buffer.
+ * @param mBuffer A multi-device buffer
+ * @return The size of the buffer, in bytes
+ */
+uint64_t mc_multi_buffer_get_size(mc_MultiBuffer* mBuffer);
+
+/**
+ * Write data to a multi-device buffer. The data is written to every device,
+ * since the part of the next run given to each device isn't known yet.
+ *
+ * @param mBuffer A multi-device buffer
+ * @param offset The offset from witch to start writing the data, in bytes
+ * @param size The size of the data to write, in bytes
+ * @param data A reference to the data to write
+ * @return The number of bytes written, 0 on error
+ */
+uint64_t mc_multi_buffer_write(
+    mc_MultiBuffer* mBuffer,
+    uint64_t offset,
+    uint64_t size,
+    void* data
+);
+
+/**
+ * Read data from a multi-device buffer. The slices of split buffers are
+ * gathered from the devices that ran them in the last run, everything else is
+ * read from the first device.
+ *
+ * @param mBuffer A multi-device buffer
+ * @param offset The offset from witch to start reading the data, in bytes
+ * @param size The size of the data to read, in bytes
+ * @param data A reference to the buffer to read the data into
+ * @return The number of bytes read, 0 on error
+ */
+uint64_t mc_multi_buffer_read(
+    mc_MultiBuffer* mBuffer,
+    uint64_t offset,
+    uint64_t size,
+    void* data
+);
+
 /**
  * Read text/data from a file
  * @param filename The name of the file to read
@@ -11,6 +11,7 @@ mc_Buffer* mc_buffer_create(
     uint64_t size
 ) {
     if (!device) return NULL;
+    if (!mc_device_open(device)) return NULL;
 
     mc_Buffer* buffer = malloc(sizeof *buffer);
     *buffer = (mc_Buffer){
@@ -18,9 +19,11 @@ mc_Buffer* mc_buffer_create(
         .device = device,
         .type = type,
         .size = size,
+        .bufSize = size,
         .map = NULL,
         .buf = NULL,
         .mem = NULL,
+        .address = 0,
     };
 
     DEBUG(buffer, "initializing buffer of size %ld", size);
@@ -35,6 +38,12 @@ mc_Buffer* mc_buffer_create(
     bufferInfo.queueFamilyIndexCount = 1;
     bufferInfo.pQueueFamilyIndices = &buffer->device->queueFamilyIdx;
 
+    // every buffer gets an address when the device can, so that any buffer
+    // can be passed to a shader by pointer
+    bool useAddress = device->get_buffer_address != NULL;
+    if (useAddress)
+        bufferInfo.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
     if (vkCreateBuffer(buffer->device->dev, &bufferInfo, NULL, &buffer->buf)) {
         ERROR(buffer, "failed to create vulkan buffer");
         mc_buffer_destroy(buffer);
@@ -49,8 +58,10 @@ mc_Buffer* mc_buffer_create(
     VkPhysicalDeviceMemoryProperties memProps;
     vkGetPhysicalDeviceMemoryProperties(buffer->device->physDev, &memProps);
 
+    bool unified = device->unifiedMemory;
     uint32_t bestMemTypeIdx = memProps.memoryTypeCount;
-    uint32_t bestMemTypeScore = 0;
+    uint64_t bestMemTypeScore = 0;
+    bool bestMappable = false;
 
     for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
         VkMemoryType memType = memProps.memoryTypes[i];
@@ -58,11 +69,17 @@ mc_Buffer* mc_buffer_create(
         bool v = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT & memType.propertyFlags;
         bool c = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT & memType.propertyFlags;
         bool d = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT & memType.propertyFlags;
+        bool h = VK_MEMORY_PROPERTY_HOST_CACHED_BIT & memType.propertyFlags;
+
+        // on unified memory, GPU buffers are read by the CPU as well, cached
+        // memory makes that much faster
+        bool dvc = d && v && c;
+        uint32_t gpuScore = d + dvc + (unified && dvc && h);
 
-        uint32_t score = 0;
+        uint64_t score = 0;
         switch (type) {
             case MC_BUFFER_TYPE_CPU: score = v && c; break;
-            case MC_BUFFER_TYPE_GPU: score = d + (d && v && c); break;
+            case MC_BUFFER_TYPE_GPU: score = gpuScore; break;
         }
 
         score *= heap.size;
@@ -81,6 +98,7 @@ mc_Buffer* mc_buffer_create(
         if (score > bestMemTypeScore) {
             bestMemTypeIdx = i;
             bestMemTypeScore = score;
+            bestMappable = v && c;
         }
     }
 
@@ -95,6 +113,11 @@ mc_Buffer* mc_buffer_create(
     memAllocInfo.allocationSize = buffer->size;
     memAllocInfo.memoryTypeIndex = bestMemTypeIdx;
 
+    VkMemoryAllocateFlagsInfo memFlagsInfo = {0};
+    memFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    memFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+    if (useAddress) memAllocInfo.pNext = &memFlagsInfo;
+
     if (vkAllocateMemory(
             buffer->device->dev,
             &memAllocInfo,
@@ -112,7 +135,17 @@ mc_Buffer* mc_buffer_create(
         return NULL;
     }
 
-    if (type != MC_BUFFER_TYPE_CPU) return buffer;
+    if (useAddress) {
+        VkBufferDeviceAddressInfo addressInfo = {0};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        addressInfo.buffer = buffer->buf;
+        buffer->address = device->get_buffer_address(device->dev, &addressInfo);
+    }
+
+    // GPU buffers in unified memory are mapped too, so hybrid buffers can
+    // skip their staging copies
+    bool map = type == MC_BUFFER_TYPE_CPU || (unified && bestMappable);
+    if (!map) return buffer;
 
     if (vkMapMemory(
             buffer->device->dev,
@@ -142,6 +175,13 @@ uint64_t mc_buffer_get_size(mc_Buffer* buffer) {
     return buffer ? buffer->size : 0;
 }
 
+uint64_t mc_buffer_get_device_address(mc_Buffer* buffer) {
+    if (!buffer) return 0;
+    if (!buffer->address)
+        ERROR(buffer, "the device doesn't support buffer device addresses");
+    return buffer->address;
+}
+
 uint64_t mc_buffer_write(
     mc_Buffer* buffer,
     uint64_t offset,
@@ -149,8 +189,8 @@ uint64_t mc_buffer_write(
     void* data
 ) {
     if (!buffer) return 0;
-    if (buffer->type != MC_BUFFER_TYPE_CPU) {
-        ERROR(buffer, "buffer type is not CPU");
+    if (!buffer->map) {
+        ERROR(buffer, "buffer is not accessible from the CPU");
         return 0;
     }
 
@@ -172,8 +212,8 @@ uint64_t mc_buffer_read(
     void* data
 ) {
     if (!buffer) return 0;
-    if (buffer->type != MC_BUFFER_TYPE_CPU) {
-        ERROR(buffer, "buffer type is not CPU");
+    if (!buffer->map) {
+        ERROR(buffer, "buffer is not accessible from the CPU");
         return 0;
     }
 
@@ -186,4 +226,100 @@ uint64_t mc_buffer_read(
 
     memcpy(data, (char*)buffer->map + offset, size);
     return size;
+}
+
+// make transfer writes visible to later dispatches and copies
+static void mc_buffer_transfer_barrier(VkCommandBuffer cmdBuff) {
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+                          | VK_ACCESS_SHADER_WRITE_BIT
+                          | VK_ACCESS_TRANSFER_READ_BIT
+                          | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+        cmdBuff,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        NULL,
+        0,
+        NULL
+    );
+}
+
+uint64_t mc_buffer_fill(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    uint32_t data
+) {
+    if (!buffer) return 0;
+    DEBUG(buffer, "filling %ld bytes of buffer with 0x%08x", size, data);
+
+    // the commands only cover the vulkan buffer, not the whole allocation
+    if (offset > buffer->bufSize || size > buffer->bufSize - offset) {
+        ERROR(buffer, "offset + size > buffer size");
+        return 0;
+    }
+
+    // the end of a buffer that isn't a multiple of 4 can still be filled, up
+    // to its last whole 32 bit value
+    bool toEnd = offset + size == buffer->bufSize;
+    if (offset % 4 != 0 || (size % 4 != 0 && !toEnd)) {
+        ERROR(buffer, "offset and size must be multiples of 4");
+        return 0;
+    }
+
+    if (size < 4) return 0;
+
+    VkCommandBuffer cmdBuff = mc_device_begin_commands(buffer->device);
+    if (!cmdBuff) return 0;
+
+    VkDeviceSize fillSize = size % 4 ? VK_WHOLE_SIZE : size;
+    vkCmdFillBuffer(cmdBuff, buffer->buf, offset, fillSize, data);
+    mc_buffer_transfer_barrier(cmdBuff);
+
+    size -= size % 4;
+    return mc_device_submit_commands(buffer->device, cmdBuff) ? size : 0;
+}
+
+uint64_t mc_buffer_update(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    void* data
+) {
+    if (!buffer) return 0;
+    DEBUG(buffer, "updating %ld bytes of buffer", size);
+
+    if (offset > buffer->bufSize || size > buffer->bufSize - offset) {
+        ERROR(buffer, "offset + size > buffer size");
+        return 0;
+    }
+
+    if (offset % 4 != 0 || size % 4 != 0) {
+        ERROR(buffer, "offset and size must be multiples of 4");
+        return 0;
+    }
+
+    if (size > 65536) {
+        ERROR(buffer, "size must be at most 65536 bytes");
+        return 0;
+    }
+
+    if (size == 0) return 0;
+
+    VkCommandBuffer cmdBuff = mc_device_begin_commands(buffer->device);
+    if (!cmdBuff) return 0;
+
+    // the data is recorded into the command buffer itself, no staging needed
+    vkCmdUpdateBuffer(cmdBuff, buffer->buf, offset, size, data);
+    mc_buffer_transfer_barrier(cmdBuff);
+
+    return mc_device_submit_commands(buffer->device, cmdBuff) ? size : 0;
 }
\ No newline at end of file
@@ -9,10 +9,12 @@ struct mc_Buffer {
     mc_Instance* _instance;
     mc_Device* device;
     mc_BufferType type;
-    uint64_t size;
+    uint64_t size; // raised to the size of the allocation
+    uint64_t bufSize; // the size `buf` was created with
     void* map;
     VkBuffer buf;
     VkDeviceMemory mem;
+    uint64_t address; // 0 if the device has no buffer device address
 };
 
 #endif // MC_BUFFER_H
\ No newline at end of file
@@ -7,12 +7,15 @@
 
 mc_BufferCopier* mc_buffer_copier_create(mc_Device* device) {
     if (!device) return NULL;
+    if (!mc_device_open(device)) return NULL;
 
     mc_BufferCopier* copier = malloc(sizeof(mc_BufferCopier));
     *copier = (mc_BufferCopier){
         ._instance = device->_instance,
         .device = device,
         .cmdPool = NULL,
+        .queueIdx = 0,
+        .fence = NULL,
     };
 
     VkCommandPoolCreateInfo cmdPoolInfo = {0};
@@ -31,6 +34,15 @@ mc_BufferCopier* mc_buffer_copier_create(mc_Device* device) {
         return NULL;
     }
 
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device->dev, &fenceInfo, NULL, &copier->fence)) {
+        ERROR(copier, "failed to create fence");
+        mc_buffer_copier_destroy(copier);
+        return NULL;
+    }
+
     return copier;
 }
 
@@ -38,11 +50,29 @@ void mc_buffer_copier_destroy(mc_BufferCopier* copier) {
     if (!copier) return;
     DEBUG(copier, "destroying buffer copier");
 
+    if (copier->fence) vkDestroyFence(copier->device->dev, copier->fence, NULL);
     if (copier->cmdPool)
         vkDestroyCommandPool(copier->device->dev, copier->cmdPool, NULL);
     free(copier);
 }
 
+bool mc_buffer_copier_set_queue(mc_BufferCopier* copier, uint32_t queue) {
+    if (!copier) return false;
+
+    if (queue >= copier->device->queueCount) {
+        ERROR(
+            copier,
+            "queue %d does not exist, the device has %d queue(s)",
+            queue,
+            copier->device->queueCount
+        );
+        return false;
+    }
+
+    copier->queueIdx = queue;
+    return true;
+}
+
 uint64_t mc_buffer_copier_copy(
     mc_BufferCopier* copier,
     mc_Buffer* src,
@@ -91,26 +121,25 @@ uint64_t mc_buffer_copier_copy(
         return 0;
     }
 
-    VkQueue queue;
-    vkGetDeviceQueue(
-        copier->device->dev,
-        copier->device->queueFamilyIdx,
-        0,
-        &queue
-    );
-
     VkSubmitInfo submitI = {0};
     submitI.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitI.commandBufferCount = 1;
     submitI.pCommandBuffers = &cmdBuf;
 
-    if (vkQueueSubmit(queue, 1, &submitI, VK_NULL_HANDLE)) {
+    VkDevice dev = copier->device->dev;
+    vkResetFences(dev, 1, &copier->fence);
+
+    VkQueue queue = mc_device_lock_queue(copier->device, copier->queueIdx);
+    VkResult res = vkQueueSubmit(queue, 1, &submitI, copier->fence);
+    mc_device_unlock_queue(copier->device, copier->queueIdx);
+
+    if (res) {
         ERROR(copier, "failed to submit queue");
         return 0;
     }
 
-    if (vkQueueWaitIdle(queue)) {
-        ERROR(copier, "failed to wait for queue");
+    if (vkWaitForFences(dev, 1, &copier->fence, VK_TRUE, UINT64_MAX)) {
+        ERROR(copier, "failed to wait for copy completion");
         return 0;
     }
 
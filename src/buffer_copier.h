@@ -9,6 +9,8 @@ struct mc_BufferCopier {
     mc_Instance* _instance;
     mc_Device* device;
     VkCommandPool cmdPool;
+    uint32_t queueIdx;
+    VkFence fence; // signaled when a copy is done
 };
 
 #endif
\ No newline at end of file
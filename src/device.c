@@ -2,10 +2,294 @@
 #include <string.h>
 
 #include "device.h"
+#include "instance.h"
 #include "log.h"
 
 uint32_t defaultReturn[] = {0, 0, 0};
 
+static bool mc_has_extension(
+    VkExtensionProperties* exts,
+    uint32_t extCount,
+    const char* name
+) {
+    for (uint32_t i = 0; i < extCount; i++)
+        if (!strcmp(exts[i].extensionName, name)) return true;
+    return false;
+}
+
+// features need an extension before the version they became core in
+static bool mc_device_has_extension(
+    mc_Device* device,
+    VkExtensionProperties* exts,
+    uint32_t extCount,
+    const char* name,
+    uint32_t coreVersion
+) {
+    if (device->apiVersion >= coreVersion) return true;
+    return mc_has_extension(exts, extCount, name);
+}
+
+static void mc_device_enable_extension(
+    mc_Device* device,
+    const char* name,
+    uint32_t coreVersion
+) {
+    if (device->apiVersion >= coreVersion) return;
+    device->exts[device->extCount++] = name;
+}
+
+// integrated GPUs and CPU devices (lavapipe) have no memory of their own, so
+// their host visible device-local memory is as fast as the rest, and GPU
+// buffers can be used from the CPU without staging copies
+static void mc_device_query_memory(mc_Device* device) {
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(device->physDev, &memProps);
+
+    bool unified = device->type == MC_DEVICE_TYPE_IGPU
+                || device->type == MC_DEVICE_TYPE_CPU;
+    VkMemoryPropertyFlags unifiedFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                       | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                       | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; unified && i < memProps.memoryTypeCount; i++) {
+        VkMemoryPropertyFlags flags = memProps.memoryTypes[i].propertyFlags;
+        if ((flags & unifiedFlags) == unifiedFlags)
+            device->unifiedMemory = true;
+    }
+
+    for (uint32_t i = 0; i < memProps.memoryHeapCount; i++) {
+        VkMemoryHeap* heap = &memProps.memoryHeaps[i];
+        if (heap->flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            device->info.deviceLocalMemory += heap->size;
+
+        for (uint32_t j = 0; j < memProps.memoryTypeCount; j++) {
+            VkMemoryType* type = &memProps.memoryTypes[j];
+            VkMemoryPropertyFlags flags = type->propertyFlags;
+            if (type->heapIndex == i
+                && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+                device->info.hostVisibleMemory += heap->size;
+                break;
+            }
+        }
+    }
+}
+
+static void mc_device_query_queue_family(
+    mc_Device* device,
+    VkPhysicalDeviceProperties* devProps
+) {
+    VkPhysicalDevice pDev = device->physDev;
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(pDev, &familyCount, NULL);
+
+    VkQueueFamilyProperties* families = malloc(sizeof *families * familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(pDev, &familyCount, families);
+
+    VkQueueFamilyProperties* family = &families[device->queueFamilyIdx];
+    device->queueCount = family->queueCount > 0 ? family->queueCount : 1;
+    if (family->timestampValidBits > 0)
+        device->info.timestampPeriod = devProps->limits.timestampPeriod;
+
+    free(families);
+}
+
+// query the features that need vulkan 1.1, and pick the ones to enable
+static void mc_device_query_features(mc_Device* device) {
+    VkPhysicalDevice pDev = device->physDev;
+
+    uint32_t extCount = 0;
+    vkEnumerateDeviceExtensionProperties(pDev, NULL, &extCount, NULL);
+    VkExtensionProperties* exts = malloc(sizeof *exts * (extCount + 1));
+    vkEnumerateDeviceExtensionProperties(pDev, NULL, &extCount, exts);
+
+    VkPhysicalDeviceSubgroupProperties subgroupProps = {0};
+    subgroupProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+
+    VkPhysicalDeviceIDProperties idProps = {0};
+    idProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    subgroupProps.pNext = &idProps;
+
+    VkPhysicalDeviceProperties2 props = {0};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &subgroupProps;
+    vkGetPhysicalDeviceProperties2(pDev, &props);
+
+    memcpy(device->uuid, idProps.deviceUUID, sizeof device->uuid);
+
+    device->info.subgroupSize = subgroupProps.subgroupSize;
+    if (subgroupProps.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT)
+        device->info.subgroupOperations = subgroupProps.supportedOperations;
+
+    VkPhysicalDevice16BitStorageFeatures storage16 = {0};
+    storage16.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES;
+    VkPhysicalDevice8BitStorageFeatures storage8 = {0};
+    storage8.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES;
+    VkPhysicalDeviceShaderFloat16Int8Features float16Int8 = {0};
+    float16Int8.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+    VkPhysicalDeviceShaderAtomicInt64Features atomicInt64 = {0};
+    atomicInt64.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline = {0};
+    timeline.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceBufferDeviceAddressFeatures address = {0};
+    address.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    VkPhysicalDeviceSynchronization2Features sync2 = {0};
+    sync2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+    VkPhysicalDeviceScalarBlockLayoutFeatures scalarLayout = {0};
+    scalarLayout.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES;
+    VkPhysicalDeviceVulkanMemoryModelFeatures memoryModel = {0};
+    memoryModel.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_MEMORY_MODEL_FEATURES;
+
+    // only chain the structs the device knows about
+    VkPhysicalDeviceFeatures2 features = {0};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &storage16;
+    void** next = &storage16.pNext;
+
+    const char* storage8Ext = "VK_KHR_8bit_storage";
+    const char* float16Int8Ext = "VK_KHR_shader_float16_int8";
+    const char* atomicInt64Ext = "VK_KHR_shader_atomic_int64";
+    const char* timelineExt = "VK_KHR_timeline_semaphore";
+    const char* addressExt = "VK_KHR_buffer_device_address";
+    const char* sync2Ext = "VK_KHR_synchronization2";
+    const char* scalarLayoutExt = "VK_EXT_scalar_block_layout";
+    const char* memoryModelExt = "VK_KHR_vulkan_memory_model";
+    uint32_t v12 = VK_API_VERSION_1_2;
+    uint32_t v13 = VK_API_VERSION_1_3;
+
+#define MC_CHAIN_IF_SUPPORTED(feature, ext, version)                           \
+    if (mc_device_has_extension(device, exts, extCount, ext, version)) {       \
+        *next = &feature;                                                      \
+        next = &feature.pNext;                                                 \
+    }
+
+    MC_CHAIN_IF_SUPPORTED(storage8, storage8Ext, v12);
+    MC_CHAIN_IF_SUPPORTED(float16Int8, float16Int8Ext, v12);
+    MC_CHAIN_IF_SUPPORTED(atomicInt64, atomicInt64Ext, v12);
+    MC_CHAIN_IF_SUPPORTED(timeline, timelineExt, v12);
+    MC_CHAIN_IF_SUPPORTED(address, addressExt, v12);
+    MC_CHAIN_IF_SUPPORTED(sync2, sync2Ext, v13);
+    MC_CHAIN_IF_SUPPORTED(scalarLayout, scalarLayoutExt, v12);
+    MC_CHAIN_IF_SUPPORTED(memoryModel, memoryModelExt, v12);
+
+#undef MC_CHAIN_IF_SUPPORTED
+
+    vkGetPhysicalDeviceFeatures2(pDev, &features);
+    free(exts);
+
+    if (storage16.storageBuffer16BitAccess) {
+        device->info.features |= MC_DEVICE_FEATURE_STORAGE_16BIT;
+        device->storage16.storageBuffer16BitAccess = VK_TRUE;
+        device->storage16.uniformAndStorageBuffer16BitAccess
+            = storage16.uniformAndStorageBuffer16BitAccess;
+    }
+    if (storage8.storageBuffer8BitAccess) {
+        device->info.features |= MC_DEVICE_FEATURE_STORAGE_8BIT;
+        device->storage8.storageBuffer8BitAccess = VK_TRUE;
+        device->storage8.uniformAndStorageBuffer8BitAccess
+            = storage8.uniformAndStorageBuffer8BitAccess;
+        mc_device_enable_extension(device, storage8Ext, v12);
+    }
+    if (float16Int8.shaderFloat16) {
+        device->info.features |= MC_DEVICE_FEATURE_FLOAT16;
+        device->float16Int8.shaderFloat16 = VK_TRUE;
+    }
+    if (float16Int8.shaderInt8) {
+        device->info.features |= MC_DEVICE_FEATURE_INT8;
+        device->float16Int8.shaderInt8 = VK_TRUE;
+    }
+    if (float16Int8.shaderFloat16 || float16Int8.shaderInt8)
+        mc_device_enable_extension(device, float16Int8Ext, v12);
+    if (atomicInt64.shaderBufferInt64Atomics) {
+        device->info.features |= MC_DEVICE_FEATURE_INT64_ATOMICS;
+        device->atomicInt64.shaderBufferInt64Atomics = VK_TRUE;
+        device->atomicInt64.shaderSharedInt64Atomics
+            = atomicInt64.shaderSharedInt64Atomics;
+        mc_device_enable_extension(device, atomicInt64Ext, v12);
+    }
+    if (timeline.timelineSemaphore) {
+        device->info.features |= MC_DEVICE_FEATURE_TIMELINE_SEMAPHORE;
+        device->timeline.timelineSemaphore = VK_TRUE;
+        mc_device_enable_extension(device, timelineExt, v12);
+    }
+    if (address.bufferDeviceAddress) {
+        device->info.features |= MC_DEVICE_FEATURE_BUFFER_DEVICE_ADDRESS;
+        device->address.bufferDeviceAddress = VK_TRUE;
+        mc_device_enable_extension(device, addressExt, v12);
+    }
+    if (sync2.synchronization2) {
+        device->info.features |= MC_DEVICE_FEATURE_SYNCHRONIZATION_2;
+        device->sync2.synchronization2 = VK_TRUE;
+        mc_device_enable_extension(device, sync2Ext, v13);
+    }
+    if (scalarLayout.scalarBlockLayout) {
+        device->info.features |= MC_DEVICE_FEATURE_SCALAR_BLOCK_LAYOUT;
+        device->scalarLayout.scalarBlockLayout = VK_TRUE;
+        mc_device_enable_extension(device, scalarLayoutExt, v12);
+    }
+    if (memoryModel.vulkanMemoryModel) {
+        device->info.features |= MC_DEVICE_FEATURE_VULKAN_MEMORY_MODEL;
+        device->memoryModel.vulkanMemoryModel = VK_TRUE;
+        device->memoryModel.vulkanMemoryModelDeviceScope
+            = memoryModel.vulkanMemoryModelDeviceScope;
+        mc_device_enable_extension(device, memoryModelExt, v12);
+    }
+}
+
+static void mc_device_query_info(
+    mc_Device* device,
+    VkPhysicalDeviceProperties* devProps
+) {
+    device->info = (mc_DeviceInfo){
+        .vendorId = devProps->vendorID,
+        .deviceId = devProps->deviceID,
+        .driverVersion = devProps->driverVersion,
+        .apiVersion = devProps->apiVersion,
+        .subgroupSize = 0,
+        .subgroupOperations = 0,
+        .maxSharedMemorySize = devProps->limits.maxComputeSharedMemorySize,
+        .maxStorageBufferRange = devProps->limits.maxStorageBufferRange,
+        .maxUniformBufferRange = devProps->limits.maxUniformBufferRange,
+        .maxPushConstantsSize = devProps->limits.maxPushConstantsSize,
+        .minStorageBufferOffsetAlignment
+        = devProps->limits.minStorageBufferOffsetAlignment,
+        .minUniformBufferOffsetAlignment
+        = devProps->limits.minUniformBufferOffsetAlignment,
+        .nonCoherentAtomSize = devProps->limits.nonCoherentAtomSize,
+        .timestampPeriod = 0.0f,
+        .deviceLocalMemory = 0,
+        .hostVisibleMemory = 0,
+        .features = 0,
+    };
+
+    mc_device_query_memory(device);
+    mc_device_query_queue_family(device, devProps);
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device->physDev, &features);
+
+    if (features.shaderFloat64) {
+        device->info.features |= MC_DEVICE_FEATURE_FLOAT64;
+        device->features.shaderFloat64 = VK_TRUE;
+    }
+    if (features.shaderInt64) {
+        device->info.features |= MC_DEVICE_FEATURE_INT64;
+        device->features.shaderInt64 = VK_TRUE;
+    }
+    if (features.shaderInt16) {
+        device->info.features |= MC_DEVICE_FEATURE_INT16;
+        device->features.shaderInt16 = VK_TRUE;
+    }
+
+    if (device->apiVersion >= VK_API_VERSION_1_1)
+        mc_device_query_features(device);
+}
+
 mc_Device* mc_device_create(
     mc_Instance* instance,
     VkPhysicalDevice physDev,
@@ -19,31 +303,40 @@ mc_Device* mc_device_create(
         .physDev = physDev,
         .queueFamilyIdx = queueFamilyIdx,
         .dev = NULL,
+        .cmdPool = NULL,
+        .cmdLock = mc_mutex_create(),
+        .queueCount = 1,
+        .queues = NULL,
+        .queueLocks = NULL,
         .type = MC_DEVICE_TYPE_OTHER,
         .maxWgSizeTotal = 0,
         .maxWgSizeShape = {0, 0, 0},
         .maxWgCount = {0, 0, 0},
         .devName = {0},
+        .info = {0},
+        .unifiedMemory = false,
+        .apiVersion = VK_API_VERSION_1_0,
+        .features = {0},
+        .storage16 = {0},
+        .storage8 = {0},
+        .float16Int8 = {0},
+        .atomicInt64 = {0},
+        .timeline = {0},
+        .address = {0},
+        .sync2 = {0},
+        .scalarLayout = {0},
+        .memoryModel = {0},
+        .extCount = 0,
+        .exts = {NULL},
+        .openLock = mc_mutex_create(),
+        .openFailed = false,
+        .get_buffer_address = NULL,
+        .uuid = {0},
+        .profileLock = mc_mutex_create(),
+        .profiled = false,
+        .profile = {0},
     };
 
-    float queuePriority = 1.0f;
-    VkDeviceQueueCreateInfo devQueueInfo = {0};
-    devQueueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    devQueueInfo.queueFamilyIndex = device->queueFamilyIdx;
-    devQueueInfo.queueCount = 1;
-    devQueueInfo.pQueuePriorities = &queuePriority;
-
-    VkDeviceCreateInfo devInfo = {0};
-    devInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    devInfo.queueCreateInfoCount = 1;
-    devInfo.pQueueCreateInfos = &devQueueInfo;
-
-    if (vkCreateDevice(device->physDev, &devInfo, NULL, &device->dev)) {
-        ERROR(device, "failed to create device");
-        mc_device_destroy(device);
-        return NULL;
-    }
-
     VkPhysicalDeviceProperties devProps;
     vkGetPhysicalDeviceProperties(device->physDev, &devProps);
 
@@ -81,16 +374,275 @@ mc_Device* mc_device_create(
 
     memcpy(device->devName, devProps.deviceName, sizeof devProps.deviceName);
 
+    // replaced by the device UUID on 1.1, the pipeline cache UUID is the
+    // closest thing on 1.0
+    memcpy(device->uuid, devProps.pipelineCacheUUID, sizeof device->uuid);
+
+    uint32_t devVersion = devProps.apiVersion & ~0xfffu;
+    device->apiVersion = devVersion < instance->apiVersion
+                           ? devVersion
+                           : instance->apiVersion;
+
+    device->storage16.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES;
+    device->storage8.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES;
+    device->float16Int8.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES;
+    device->atomicInt64.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_INT64_FEATURES;
+    device->timeline.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    device->address.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    device->sync2.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+    device->scalarLayout.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES;
+    device->memoryModel.sType
+        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_MEMORY_MODEL_FEATURES;
+
+    mc_device_query_info(device, &devProps);
+
     return device;
 }
 
+bool mc_device_open(mc_Device* device) {
+    mc_mutex_lock(device->openLock);
+    bool ok = device->dev != NULL;
+    if (ok || device->openFailed) goto end;
+
+    DEBUG(device, "opening device %s", device->devName);
+
+    uint32_t queueCount = device->queueCount;
+    float* queuePriorities = malloc(sizeof *queuePriorities * queueCount);
+    for (uint32_t i = 0; i < queueCount; i++) queuePriorities[i] = 1.0f;
+
+    VkDeviceQueueCreateInfo devQueueInfo = {0};
+    devQueueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    devQueueInfo.queueFamilyIndex = device->queueFamilyIdx;
+    devQueueInfo.queueCount = queueCount;
+    devQueueInfo.pQueuePriorities = queuePriorities;
+
+    VkDeviceCreateInfo devInfo = {0};
+    devInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    devInfo.queueCreateInfoCount = 1;
+    devInfo.pQueueCreateInfos = &devQueueInfo;
+    devInfo.enabledExtensionCount = device->extCount;
+    devInfo.ppEnabledExtensionNames = device->exts;
+
+    // enable the features found in `mc_device_create()`
+    VkPhysicalDeviceFeatures2 features = {0};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.features = device->features;
+
+    if (device->apiVersion >= VK_API_VERSION_1_1) {
+        void** next = &features.pNext;
+        uint32_t flags = device->info.features;
+        if (flags & MC_DEVICE_FEATURE_STORAGE_16BIT) {
+            *next = &device->storage16;
+            next = &device->storage16.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_STORAGE_8BIT) {
+            *next = &device->storage8;
+            next = &device->storage8.pNext;
+        }
+        if (flags & (MC_DEVICE_FEATURE_FLOAT16 | MC_DEVICE_FEATURE_INT8)) {
+            *next = &device->float16Int8;
+            next = &device->float16Int8.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_INT64_ATOMICS) {
+            *next = &device->atomicInt64;
+            next = &device->atomicInt64.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_TIMELINE_SEMAPHORE) {
+            *next = &device->timeline;
+            next = &device->timeline.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_BUFFER_DEVICE_ADDRESS) {
+            *next = &device->address;
+            next = &device->address.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_SYNCHRONIZATION_2) {
+            *next = &device->sync2;
+            next = &device->sync2.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_SCALAR_BLOCK_LAYOUT) {
+            *next = &device->scalarLayout;
+            next = &device->scalarLayout.pNext;
+        }
+        if (flags & MC_DEVICE_FEATURE_VULKAN_MEMORY_MODEL) {
+            *next = &device->memoryModel;
+            next = &device->memoryModel.pNext;
+        }
+        *next = NULL;
+        devInfo.pNext = &features;
+    } else {
+        devInfo.pEnabledFeatures = &device->features;
+    }
+
+    VkResult res
+        = vkCreateDevice(device->physDev, &devInfo, NULL, &device->dev);
+    free(queuePriorities);
+    if (res) {
+        ERROR(device, "failed to create device");
+        device->dev = NULL;
+        goto end;
+    }
+
+    device->queues = malloc(sizeof *device->queues * device->queueCount);
+    device->queueLocks
+        = malloc(sizeof *device->queueLocks * device->queueCount);
+    for (uint32_t i = 0; i < device->queueCount; i++) {
+        vkGetDeviceQueue(
+            device->dev,
+            device->queueFamilyIdx,
+            i,
+            &device->queues[i]
+        );
+        device->queueLocks[i] = mc_mutex_create();
+    }
+
+    DEBUG(device, "opened %d compute queue(s)", device->queueCount);
+
+    if (device->info.features & MC_DEVICE_FEATURE_BUFFER_DEVICE_ADDRESS) {
+        const char* name = device->apiVersion >= VK_API_VERSION_1_2
+                             ? "vkGetBufferDeviceAddress"
+                             : "vkGetBufferDeviceAddressKHR";
+        device->get_buffer_address = (PFN_vkGetBufferDeviceAddress)
+            vkGetDeviceProcAddr(device->dev, name);
+    }
+
+    VkCommandPoolCreateInfo cmdPoolInfo = {0};
+    cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    cmdPoolInfo.queueFamilyIndex = device->queueFamilyIdx;
+
+    if (vkCreateCommandPool(
+            device->dev,
+            &cmdPoolInfo,
+            NULL,
+            &device->cmdPool
+        )) {
+        ERROR(device, "failed to create command pool");
+        goto end;
+    }
+
+    ok = true;
+
+end:
+    // don't retry a device that failed, and don't keep half of it
+    if (!ok && !device->openFailed) {
+        device->openFailed = true;
+        if (device->dev) vkDestroyDevice(device->dev, NULL);
+        device->dev = NULL;
+    }
+    mc_mutex_unlock(device->openLock);
+    return ok;
+}
+
 void mc_device_destroy(mc_Device* device) {
     if (!device) return;
     DEBUG(device, "destroying device");
+    if (device->cmdPool)
+        vkDestroyCommandPool(device->dev, device->cmdPool, NULL);
     if (device->dev) vkDestroyDevice(device->dev, NULL);
+    if (device->queueLocks) {
+        for (uint32_t i = 0; i < device->queueCount; i++)
+            mc_mutex_destroy(device->queueLocks[i]);
+        free(device->queueLocks);
+    }
+    if (device->queues) free(device->queues);
+    mc_mutex_destroy(device->cmdLock);
+    mc_mutex_destroy(device->openLock);
+    mc_mutex_destroy(device->profileLock);
     free(device);
 }
 
+VkQueue mc_device_lock_queue(mc_Device* device, uint32_t queueIdx) {
+    mc_mutex_lock(device->queueLocks[queueIdx]);
+    return device->queues[queueIdx];
+}
+
+void mc_device_unlock_queue(mc_Device* device, uint32_t queueIdx) {
+    mc_mutex_unlock(device->queueLocks[queueIdx]);
+}
+
+VkCommandBuffer mc_device_begin_commands(mc_Device* device) {
+    mc_mutex_lock(device->cmdLock);
+
+    VkCommandBufferAllocateInfo cmdBuffAllocInfo = {0};
+    cmdBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdBuffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdBuffAllocInfo.commandPool = device->cmdPool;
+    cmdBuffAllocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmdBuff;
+    if (vkAllocateCommandBuffers(device->dev, &cmdBuffAllocInfo, &cmdBuff)) {
+        ERROR(device, "failed to allocate command buffer");
+        mc_mutex_unlock(device->cmdLock);
+        return NULL;
+    }
+
+    VkCommandBufferBeginInfo cmdBuffBeginInfo = {0};
+    cmdBuffBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmdBuffBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(cmdBuff, &cmdBuffBeginInfo)) {
+        ERROR(device, "failed to begin command buffer");
+        vkFreeCommandBuffers(device->dev, device->cmdPool, 1, &cmdBuff);
+        mc_mutex_unlock(device->cmdLock);
+        return NULL;
+    }
+
+    return cmdBuff;
+}
+
+bool mc_device_submit_commands(mc_Device* device, VkCommandBuffer cmdBuff) {
+    bool ok = false;
+    VkFence fence = NULL;
+
+    if (vkEndCommandBuffer(cmdBuff)) {
+        ERROR(device, "failed to end command buffer");
+        goto end;
+    }
+
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device->dev, &fenceInfo, NULL, &fence)) {
+        ERROR(device, "failed to create fence");
+        goto end;
+    }
+
+    VkSubmitInfo submitInfo = {0};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuff;
+
+    VkQueue queue = mc_device_lock_queue(device, 0);
+    VkResult res = vkQueueSubmit(queue, 1, &submitInfo, fence);
+    mc_device_unlock_queue(device, 0);
+
+    if (res) {
+        ERROR(device, "failed to submit queue");
+        goto end;
+    }
+
+    if (vkWaitForFences(device->dev, 1, &fence, VK_TRUE, UINT64_MAX)) {
+        ERROR(device, "failed to wait for fence");
+        goto end;
+    }
+
+    ok = true;
+
+end:
+    if (fence) vkDestroyFence(device->dev, fence, NULL);
+    vkFreeCommandBuffers(device->dev, device->cmdPool, 1, &cmdBuff);
+    mc_mutex_unlock(device->cmdLock);
+    return ok;
+}
+
 mc_DeviceType mc_device_get_type(mc_Device* device) {
     return device ? device->type : MC_DEVICE_TYPE_OTHER;
 }
@@ -109,4 +661,24 @@ uint32_t* mc_device_get_max_workgroup_count(mc_Device* device) {
 
 char* mc_device_get_name(mc_Device* device) {
     return device ? device->devName : NULL;
-}
\ No newline at end of file
+}
+
+const mc_DeviceInfo* mc_device_get_info(mc_Device* device) {
+    return device ? &device->info : NULL;
+}
+
+bool mc_device_has_features(mc_Device* device, uint32_t features) {
+    return device ? (device->info.features & features) == features : false;
+}
+
+bool mc_device_has_unified_memory(mc_Device* device) {
+    return device ? device->unifiedMemory : false;
+}
+
+uint32_t mc_device_get_api_version(mc_Device* device) {
+    return device ? device->apiVersion : 0;
+}
+
+uint32_t mc_device_get_queue_count(mc_Device* device) {
+    return device ? device->queueCount : 0;
+}
@@ -4,17 +4,48 @@
 #include <vulkan/vulkan.h>
 
 #include "microcompute.h"
+#include "misc.h"
 
 struct mc_Device {
     mc_Instance* _instance;
     VkPhysicalDevice physDev;
     uint32_t queueFamilyIdx;
-    VkDevice dev;
+    VkDevice dev;          // `NULL` until the device is first used
+    VkCommandPool cmdPool; // created with `dev`, guarded by `cmdLock`
+    mc_Mutex* cmdLock;
+    uint32_t queueCount; // all queues of the family are opened
+    VkQueue* queues;
+    mc_Mutex** queueLocks; // queues must not be used from two threads at once
     mc_DeviceType type;
     uint32_t maxWgSizeTotal;
     uint32_t maxWgSizeShape[3];
     uint32_t maxWgCount[3];
     char devName[256];
+    mc_DeviceInfo info;
+    bool unifiedMemory; // GPU buffers are mapped as well
+    uint32_t apiVersion; // usable version, min(device, instance)
+    // what gets enabled when the device is opened, only the features in
+    // `info.features` are set
+    VkPhysicalDeviceFeatures features;
+    VkPhysicalDevice16BitStorageFeatures storage16;
+    VkPhysicalDevice8BitStorageFeatures storage8;
+    VkPhysicalDeviceShaderFloat16Int8Features float16Int8;
+    VkPhysicalDeviceShaderAtomicInt64Features atomicInt64;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline;
+    VkPhysicalDeviceBufferDeviceAddressFeatures address;
+    VkPhysicalDeviceSynchronization2Features sync2;
+    VkPhysicalDeviceScalarBlockLayoutFeatures scalarLayout;
+    VkPhysicalDeviceVulkanMemoryModelFeatures memoryModel;
+    uint32_t extCount;
+    const char* exts[8];
+    mc_Mutex* openLock;
+    bool openFailed;
+    // core in 1.2, loaded at open since it comes from an extension before
+    PFN_vkGetBufferDeviceAddress get_buffer_address;
+    uint8_t uuid[VK_UUID_SIZE];
+    mc_Mutex* profileLock;
+    bool profiled; // measured or loaded by the first `mc_device_get_profile()`
+    mc_DeviceProfile profile;
 };
 
 mc_Device* mc_device_create(
@@ -25,4 +56,19 @@ mc_Device* mc_device_create(
 
 void mc_device_destroy(mc_Device* device);
 
+// create the vulkan device if it hasn't been yet, call before using `dev`
+bool mc_device_open(mc_Device* device);
+
+// the queue is locked until `mc_device_unlock_queue()`, hold it while calling
+// any `vkQueue*` function
+VkQueue mc_device_lock_queue(mc_Device* device, uint32_t queueIdx);
+
+void mc_device_unlock_queue(mc_Device* device, uint32_t queueIdx);
+
+// one time commands on queue 0, the command pool stays locked until the
+// commands are submitted
+VkCommandBuffer mc_device_begin_commands(mc_Device* device);
+
+bool mc_device_submit_commands(mc_Device* device, VkCommandBuffer cmdBuff);
+
 #endif // MC_DEVICE_H
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "device.h"
+#include "instance.h"
+#include "log.h"
+#include "mc_device_profile_spv.h"
+#include "misc.h"
+
+#define MC_DEVICE_PROFILE_MAGIC 0x5044434d // "MCDP"
+#define MC_DEVICE_PROFILE_VERSION 1
+// large enough to hide the submission overhead, small enough for any device
+#define MC_DEVICE_PROFILE_COPY_SIZE ((uint64_t)16 << 20)
+#define MC_DEVICE_PROFILE_REPEAT 4
+#define MC_DEVICE_PROFILE_WORKGROUPS 1024
+#define MC_DEVICE_PROFILE_LOCAL_SIZE 64 // matches device_profile.glsl
+#define MC_DEVICE_PROFILE_FLOPS_PER_ITERATION 32
+#define MC_DEVICE_PROFILE_MIN_TIME 0.02
+#define MC_DEVICE_PROFILE_MAX_ITERATIONS (1u << 20)
+
+typedef struct mc_DeviceProfileEntry {
+    uint32_t magic;
+    uint32_t version;
+    uint8_t uuid[VK_UUID_SIZE];
+    uint32_t driverVersion;
+    uint32_t reserved;
+    mc_DeviceProfile profile;
+    uint64_t checksum;
+} mc_DeviceProfileEntry;
+
+// profiles are only valid for one device with one driver version
+static char* mc_device_profile_path(mc_Device* device) {
+    char uuid[2 * VK_UUID_SIZE + 1];
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+        snprintf(&uuid[2 * i], 3, "%02x", device->uuid[i]);
+
+    const char* fmt = "%s/%s-%08x.profile";
+    const char* dir = device->_instance->cacheDir;
+    uint32_t driver = device->info.driverVersion;
+    int len = snprintf(NULL, 0, fmt, dir, uuid, driver);
+    char* path = malloc(len + 1);
+    snprintf(path, len + 1, fmt, dir, uuid, driver);
+    return path;
+}
+
+static bool mc_device_profile_load(mc_Device* device) {
+    if (!device->_instance->cacheDir) return false;
+
+    char* path = mc_device_profile_path(device);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        DEBUG(device, "no cached profile at %s", path);
+        free(path);
+        return false;
+    }
+
+    mc_DeviceProfileEntry entry = {0};
+    bool ok = fread(&entry, sizeof entry, 1, fp) == 1 && fgetc(fp) == EOF;
+    fclose(fp);
+
+    uint64_t checksum
+        = mc_hash(MC_HASH_SEED, &entry.profile, sizeof entry.profile);
+    ok = ok && entry.magic == MC_DEVICE_PROFILE_MAGIC
+      && entry.version == MC_DEVICE_PROFILE_VERSION
+      && !memcmp(entry.uuid, device->uuid, sizeof entry.uuid)
+      && entry.driverVersion == device->info.driverVersion
+      && entry.checksum == checksum;
+
+    if (ok) {
+        DEBUG(device, "loaded cached profile from %s", path);
+        device->profile = entry.profile;
+    } else {
+        WARN(device, "ignoring invalid profile %s", path);
+        remove(path);
+    }
+
+    free(path);
+    return ok;
+}
+
+static bool mc_device_profile_write(FILE* fp, void* arg) {
+    return fwrite(arg, sizeof(mc_DeviceProfileEntry), 1, fp) == 1;
+}
+
+static void mc_device_profile_store(mc_Device* device) {
+    if (!device->_instance->cacheDir) return;
+
+    const char* dir = device->_instance->cacheDir;
+    if (!mc_make_dirs(dir)) {
+        WARN(device, "failed to create cache directory %s", dir);
+        return;
+    }
+
+    mc_DeviceProfileEntry entry = {
+        .magic = MC_DEVICE_PROFILE_MAGIC,
+        .version = MC_DEVICE_PROFILE_VERSION,
+        .uuid = {0},
+        .driverVersion = device->info.driverVersion,
+        .reserved = 0,
+        .profile = device->profile,
+        .checksum
+        = mc_hash(MC_HASH_SEED, &device->profile, sizeof device->profile),
+    };
+    memcpy(entry.uuid, device->uuid, sizeof entry.uuid);
+
+    // several instances in one process may store the same profile, the device
+    // tells them apart
+    char* path = mc_device_profile_path(device);
+    if (mc_write_file_atomic(path, device, mc_device_profile_write, &entry))
+        DEBUG(device, "stored profile at %s", path);
+    else
+        WARN(device, "failed to write profile %s", path);
+
+    free(path);
+}
+
+// the best of a few copies, in bytes per second
+static double mc_device_profile_copy(
+    mc_BufferCopier* copier,
+    mc_Buffer* src,
+    mc_Buffer* dst
+) {
+    uint64_t size = MC_DEVICE_PROFILE_COPY_SIZE;
+    double best = 0.0;
+    for (uint32_t i = 0; i < MC_DEVICE_PROFILE_REPEAT; i++) {
+        double startTime = mc_get_time();
+        if (mc_buffer_copier_copy(copier, src, dst, 0, 0, size) != size)
+            return 0.0;
+        double time = mc_get_time() - startTime;
+        if (time > 0.0 && (best == 0.0 || time < best)) best = time;
+    }
+    return best > 0.0 ? size / best : 0.0;
+}
+
+// wall time of a run, including the submission
+static double mc_device_profile_run(
+    mc_Program* program,
+    mc_Buffer* out,
+    uint32_t workgroups,
+    uint32_t iterations
+) {
+    mc_program_set_push_constants(program, sizeof iterations, &iterations);
+    double startTime = mc_get_time();
+    if (mc_program_run(program, workgroups, 1, 1, out) < 0.0) return -1.0;
+    return mc_get_time() - startTime;
+}
+
+static bool mc_device_profile_programs(
+    mc_Device* device,
+    mc_Program* program,
+    mc_Buffer* out
+) {
+    mc_DeviceProfile* profile = &device->profile;
+
+    // the first run includes recording the command buffer, skip it
+    if (mc_device_profile_run(program, out, 1, 0) < 0.0) return false;
+
+    profile->dispatchLatency = 0.0;
+    for (uint32_t i = 0; i < MC_DEVICE_PROFILE_REPEAT; i++) {
+        double time = mc_device_profile_run(program, out, 1, 0);
+        if (time < 0.0) return false;
+        if (i == 0 || time < profile->dispatchLatency)
+            profile->dispatchLatency = time;
+    }
+
+    // grow the work until it takes long enough to be measured reliably
+    uint32_t workgroups = MC_DEVICE_PROFILE_WORKGROUPS;
+    uint32_t iterations = 16;
+    double time;
+    while (true) {
+        time = mc_device_profile_run(program, out, workgroups, iterations);
+        if (time < 0.0) return false;
+        if (time >= MC_DEVICE_PROFILE_MIN_TIME
+            || iterations >= MC_DEVICE_PROFILE_MAX_ITERATIONS)
+            break;
+        iterations *= 4;
+    }
+
+    double ops = (double)workgroups * MC_DEVICE_PROFILE_LOCAL_SIZE * iterations
+               * MC_DEVICE_PROFILE_FLOPS_PER_ITERATION;
+    double computeTime = time - profile->dispatchLatency;
+    profile->flops = ops / (computeTime > 0.0 ? computeTime : time);
+    return true;
+}
+
+static bool mc_device_profile_measure(mc_Device* device) {
+    INFO(device, "calibrating %s", device->devName);
+
+    uint64_t size = MC_DEVICE_PROFILE_COPY_SIZE;
+    uint64_t outSize = (uint64_t)MC_DEVICE_PROFILE_WORKGROUPS
+                     * MC_DEVICE_PROFILE_LOCAL_SIZE * sizeof(float);
+
+    mc_Buffer* cpuBuff = mc_buffer_create(device, MC_BUFFER_TYPE_CPU, size);
+    mc_Buffer* gpuBuff = mc_buffer_create(device, MC_BUFFER_TYPE_GPU, size);
+    mc_Buffer* gpuBuff2 = mc_buffer_create(device, MC_BUFFER_TYPE_GPU, size);
+    mc_Buffer* out = mc_buffer_create(device, MC_BUFFER_TYPE_GPU, outSize);
+    mc_BufferCopier* copier = mc_buffer_copier_create(device);
+    mc_ProgramCode* code = mc_program_code_create_from_spirv(
+        device->_instance,
+        mc_device_profile_spv_size,
+        (const char*)mc_device_profile_spv
+    );
+    mc_Program* program = mc_program_create(device, code);
+
+    bool ok = cpuBuff && gpuBuff && gpuBuff2 && out && copier && program;
+    if (ok) {
+        mc_DeviceProfile* profile = &device->profile;
+        profile->uploadBandwidth
+            = mc_device_profile_copy(copier, cpuBuff, gpuBuff);
+        profile->downloadBandwidth
+            = mc_device_profile_copy(copier, gpuBuff, cpuBuff);
+        profile->deviceBandwidth
+            = mc_device_profile_copy(copier, gpuBuff, gpuBuff2);
+        ok = profile->uploadBandwidth > 0.0
+          && profile->downloadBandwidth > 0.0
+          && profile->deviceBandwidth > 0.0
+          && mc_device_profile_programs(device, program, out);
+    }
+
+    mc_program_destroy(program);
+    mc_program_code_destroy(code);
+    mc_buffer_copier_destroy(copier);
+    mc_buffer_destroy(out);
+    mc_buffer_destroy(gpuBuff2);
+    mc_buffer_destroy(gpuBuff);
+    mc_buffer_destroy(cpuBuff);
+
+    if (!ok) ERROR(device, "failed to calibrate %s", device->devName);
+    return ok;
+}
+
+const mc_DeviceProfile* mc_device_get_profile(mc_Device* device) {
+    if (!device) return NULL;
+
+    mc_mutex_lock(device->profileLock);
+    if (!device->profiled) {
+        device->profiled = mc_device_profile_load(device);
+        if (!device->profiled && mc_device_profile_measure(device)) {
+            device->profiled = true;
+            mc_device_profile_store(device);
+        }
+    }
+    bool profiled = device->profiled;
+    mc_mutex_unlock(device->profileLock);
+
+    return profiled ? &device->profile : NULL;
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// calibration program of `mc_device_get_profile()`, every invocation runs
+// `iterations` rounds of 4 independent vec4 multiply-adds (32 flops), nothing
+// with 0 iterations
+
+layout(local_size_x = 64) in;
+
+layout(push_constant) uniform Push {
+    uint iterations;
+};
+
+layout(std430, binding = 0) buffer Out {
+    float values[];
+};
+
+void main(void) {
+    uint idx = gl_GlobalInvocationID.x;
+
+    vec4 a = vec4(float(idx) * 1e-6);
+    vec4 b = a + 0.25;
+    vec4 c = a + 0.5;
+    vec4 d = a + 0.75;
+
+    for (uint i = 0; i < iterations; i++) {
+        a = a * 0.999 + 0.001;
+        b = b * 0.999 + 0.001;
+        c = c * 0.999 + 0.001;
+        d = d * 0.999 + 0.001;
+    }
+
+    // keep the results, so the loop isn't optimized away
+    values[idx] = dot(a + b + c + d, vec4(1.0));
+}
@@ -1,11 +1,101 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#define open _open
+#define close _close
+#define MC_OPEN_FLAGS (_O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY)
+#else
+#include <unistd.h>
+#define MC_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#endif
 
 #include "buffer.h"
 #include "device.h"
 #include "hybrid_buffer.h"
 #include "log.h"
 #include "microcompute_extra.h"
+#include "transfer.h"
+
+static FILE* mc_open_file(const char* filename, uint64_t* size) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) return NULL;
+
+    // reads go straight into mapped memory, skip the stdio buffer
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    // ftell fails on anything that isn't a regular file (pipes, sockets)
+    long pos = fseek(fp, 0, SEEK_END) ? -1 : ftell(fp);
+    if (pos < 0 || fseek(fp, 0, SEEK_SET)) {
+        fclose(fp);
+        return NULL;
+    }
+
+    *size = (uint64_t)pos;
+    return fp;
+}
+
+static bool mc_write_fd(int fd, const char* data, uint64_t size) {
+    while (size > 0) {
+        // write() may return early, keep going until everything is written
+        unsigned int len = size < (1u << 30) ? (unsigned int)size : 1u << 30;
+        long res = write(fd, data, len);
+        if (res < 0 && errno == EINTR) continue;
+        if (res <= 0) return false;
+        data += res;
+        size -= res;
+    }
+
+    return true;
+}
+
+// read `size` bytes from `fp` and copy them to `dst`, one chunk at a time, so
+// the next chunk is read while the previous one is being copied. If `src` is
+// `NULL`, the chunks go through the staging buffers of `transfer`, otherwise
+// they are read into `src` at the same offsets as in `dst`.
+static bool mc_load_chunks(
+    mc_Transfer* transfer,
+    FILE* fp,
+    mc_Buffer* src,
+    mc_Buffer* dst,
+    uint64_t offset,
+    uint64_t size,
+    uint64_t chunkSize
+) {
+    for (uint64_t i = 0, done = 0; done < size; i++) {
+        mc_TransferSlot* slot = mc_transfer_acquire(transfer, i);
+        if (!slot) return false;
+
+        uint64_t len = size - done < chunkSize ? size - done : chunkSize;
+        mc_Buffer* from = src ? src : slot->buff;
+        uint64_t fromOffset = src ? offset + done : 0;
+
+        if (fread((char*)from->map + fromOffset, 1, len, fp) != len) {
+            ERROR(transfer, "failed to read file");
+            return false;
+        }
+
+        if (!mc_transfer_copy(
+                transfer,
+                slot,
+                from,
+                dst,
+                fromOffset,
+                offset + done,
+                len
+            ))
+            return false;
+
+        done += len;
+    }
+
+    return mc_transfer_finish(transfer);
+}
 
 mc_Buffer* mc_buffer_create_from(
     mc_Device* device,
@@ -26,7 +116,7 @@ mc_Buffer* mc_buffer_realloc(mc_Buffer* buffer, uint64_t size) {
     mc_Buffer* new = mc_buffer_create(buffer->device, buffer->type, size);
     if (!new) return NULL;
 
-    if (buffer->type == MC_BUFFER_TYPE_CPU) {
+    if (buffer->map && new->map) {
         uint64_t minSize = size < buffer->size ? size : buffer->size;
         mc_buffer_write(new, 0, minSize, buffer->map);
     } else {
@@ -50,19 +140,225 @@ mc_HBuffer* mc_hybrid_buffer_realloc(mc_HBuffer* old, uint64_t size) {
     if (!new) return NULL;
 
     uint64_t minSize = size < old->gpuBuff.size ? size : old->gpuBuff.size;
-    mc_buffer_copier_copy(
-        old->copier,
-        &new->gpuBuff,
-        &old->gpuBuff,
-        0,
-        0,
-        minSize
-    );
+    if (old->gpuBuff.map && new->gpuBuff.map) {
+        memcpy(new->gpuBuff.map, old->gpuBuff.map, minSize);
+    } else {
+        mc_buffer_copier_copy(
+            old->copier ? old->copier : new->copier,
+            &old->gpuBuff,
+            &new->gpuBuff,
+            0,
+            0,
+            minSize
+        );
+    }
 
     mc_hybrid_buffer_destroy(old);
     return new;
 }
 
+uint64_t mc_buffer_load_file(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    const char* filename
+) {
+    if (!buffer) return 0;
+    DEBUG(buffer, "loading \"%s\" into buffer", filename);
+
+    uint64_t size;
+    FILE* fp = mc_open_file(filename, &size);
+    if (!fp) {
+        ERROR(buffer, "failed to open \"%s\"", filename);
+        return 0;
+    }
+
+    if (offset > buffer->size || size > buffer->size - offset) {
+        ERROR(buffer, "offset + file size > buffer size");
+        fclose(fp);
+        return 0;
+    }
+
+    if (buffer->map) {
+        uint64_t res = fread((char*)buffer->map + offset, 1, size, fp);
+        fclose(fp);
+        if (res != size) {
+            ERROR(buffer, "failed to read \"%s\"", filename);
+            return 0;
+        }
+        return res;
+    }
+
+    uint64_t chunkSize
+        = size < MC_TRANSFER_CHUNK_SIZE ? size : MC_TRANSFER_CHUNK_SIZE;
+    mc_Transfer* transfer = mc_transfer_create(buffer->device, chunkSize, 2);
+    if (!transfer) {
+        fclose(fp);
+        return 0;
+    }
+
+    bool ok
+        = mc_load_chunks(transfer, fp, NULL, buffer, offset, size, chunkSize);
+
+    mc_transfer_destroy(transfer);
+    fclose(fp);
+    return ok ? size : 0;
+}
+
+mc_HBuffer* mc_hybrid_buffer_create_from_file(
+    mc_Device* device,
+    const char* filename
+) {
+    if (!device) return NULL;
+    DEBUG(device, "creating hybrid buffer from \"%s\"", filename);
+
+    uint64_t size;
+    FILE* fp = mc_open_file(filename, &size);
+    if (!fp) {
+        ERROR(device, "failed to open \"%s\"", filename);
+        return NULL;
+    }
+
+    if (size == 0) {
+        ERROR(device, "\"%s\" is empty", filename);
+        fclose(fp);
+        return NULL;
+    }
+
+    mc_HBuffer* hBuffer = mc_hybrid_buffer_create(device, size);
+
+    // on unified memory there is nothing to copy, read the file in place
+    if (hBuffer && !hBuffer->cpuBuff) {
+        bool ok = fread(hBuffer->gpuBuff.map, 1, size, fp) == size;
+        fclose(fp);
+        if (!ok) {
+            ERROR(device, "failed to read \"%s\"", filename);
+            mc_hybrid_buffer_destroy(hBuffer);
+            return NULL;
+        }
+        return hBuffer;
+    }
+
+    mc_Transfer* transfer = mc_transfer_create(device, 0, 2);
+
+    // the chunks are read straight into the mapped cpu side of the buffer
+    bool ok = hBuffer && transfer
+           && mc_load_chunks(
+                  transfer,
+                  fp,
+                  hBuffer->cpuBuff,
+                  &hBuffer->gpuBuff,
+                  0,
+                  size,
+                  MC_TRANSFER_CHUNK_SIZE
+              );
+
+    mc_transfer_destroy(transfer);
+    fclose(fp);
+
+    if (!ok) {
+        mc_hybrid_buffer_destroy(hBuffer);
+        return NULL;
+    }
+
+    return hBuffer;
+}
+
+uint64_t mc_buffer_save_fd(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    int fd
+) {
+    if (!buffer) return 0;
+    DEBUG(buffer, "saving %ld bytes from buffer", size);
+
+    if (offset > buffer->size || size > buffer->size - offset) {
+        ERROR(buffer, "offset + size > buffer size");
+        return 0;
+    }
+
+    if (buffer->map) {
+        if (!mc_write_fd(fd, (char*)buffer->map + offset, size)) {
+            ERROR(buffer, "failed to write file");
+            return 0;
+        }
+        return size;
+    }
+
+    if (size == 0) return 0;
+
+    uint64_t chunkSize
+        = size < MC_TRANSFER_CHUNK_SIZE ? size : MC_TRANSFER_CHUNK_SIZE;
+    uint64_t chunkCount = (size + chunkSize - 1) / chunkSize;
+
+    mc_Transfer* transfer = mc_transfer_create(buffer->device, chunkSize, 2);
+    if (!transfer) return 0;
+
+    // chunk i + 1 is copied to staging memory while chunk i is written
+    bool ok = mc_transfer_copy(
+        transfer,
+        mc_transfer_acquire(transfer, 0),
+        buffer,
+        transfer->slots[0].buff,
+        offset,
+        0,
+        chunkSize
+    );
+
+    for (uint64_t i = 0; ok && i < chunkCount; i++) {
+        if (i + 1 < chunkCount) {
+            uint64_t next = (i + 1) * chunkSize;
+            uint64_t len = size - next < chunkSize ? size - next : chunkSize;
+            mc_TransferSlot* slot = mc_transfer_acquire(transfer, i + 1);
+            ok = slot
+              && mc_transfer_copy(
+                     transfer,
+                     slot,
+                     buffer,
+                     slot->buff,
+                     offset + next,
+                     0,
+                     len
+                 );
+            if (!ok) break;
+        }
+
+        mc_TransferSlot* slot = &transfer->slots[i % transfer->slotCount];
+        uint64_t len = size - i * chunkSize;
+        if (len > chunkSize) len = chunkSize;
+
+        ok = mc_transfer_wait(transfer, slot)
+          && mc_write_fd(fd, slot->buff->map, len);
+        if (!ok) ERROR(buffer, "failed to save buffer");
+    }
+
+    mc_transfer_destroy(transfer);
+    return ok ? size : 0;
+}
+
+uint64_t mc_buffer_save_file(
+    mc_Buffer* buffer,
+    uint64_t offset,
+    uint64_t size,
+    const char* filename
+) {
+    if (!buffer) return 0;
+
+    int fd = open(filename, MC_OPEN_FLAGS, 0644);
+    if (fd < 0) {
+        ERROR(buffer, "failed to open \"%s\"", filename);
+        return 0;
+    }
+
+    uint64_t res = mc_buffer_save_fd(buffer, offset, size, fd);
+    if (close(fd)) {
+        ERROR(buffer, "failed to close \"%s\"", filename);
+        return 0;
+    }
+
+    return res;
+}
+
 char* read_file(const char* filename, size_t* size) {
     FILE* fp = fopen(filename, "rb");
 
@@ -27,6 +27,9 @@ mc_HBuffer* mc_hybrid_buffer_create(mc_Device* device, uint64_t size) {
     memcpy(&hBuffer->gpuBuff, gpuBuffer, sizeof *gpuBuffer);
     free(gpuBuffer);
 
+    // on unified memory the GPU side is mapped, and is all there is
+    if (hBuffer->gpuBuff.map) return hBuffer;
+
     hBuffer->cpuBuff = mc_buffer_create(device, MC_BUFFER_TYPE_CPU, size);
     if (!hBuffer->cpuBuff) {
         mc_hybrid_buffer_destroy(hBuffer);
@@ -80,6 +83,9 @@ uint64_t mc_hybrid_buffer_write(
     if (!hBuffer) return 0;
     DEBUG(hBuffer, "writing %ld bytes to hybrid buffer", size);
 
+    if (!hBuffer->cpuBuff)
+        return mc_buffer_write(&hBuffer->gpuBuff, offset, size, data);
+
     uint64_t res = mc_buffer_write(hBuffer->cpuBuff, offset, size, data);
     if (res != size) return res;
 
@@ -102,6 +108,9 @@ uint64_t mc_hybrid_buffer_read(
     if (!hBuffer) return 0;
     DEBUG(hBuffer, "reading %ld bytes from hybrid buffer", size);
 
+    if (!hBuffer->cpuBuff)
+        return mc_buffer_read(&hBuffer->gpuBuff, offset, size, data);
+
     uint64_t res = mc_buffer_copier_copy(
         hBuffer->copier,
         &hBuffer->gpuBuff,
@@ -114,3 +123,142 @@ uint64_t mc_hybrid_buffer_read(
 
     return mc_buffer_read(hBuffer->cpuBuff, offset, size, data);
 }
+
+// check the ranges and return the device they all belong to
+static mc_Device* mc_hybrid_buffer_check_ranges(
+    uint32_t count,
+    mc_HBufferRange* ranges
+) {
+    if (count == 0 || !ranges || !ranges[0].hBuffer) return NULL;
+
+    mc_HBuffer* first = ranges[0].hBuffer;
+    for (uint32_t i = 0; i < count; i++) {
+        mc_HBuffer* hBuffer = ranges[i].hBuffer;
+        if (!hBuffer) {
+            ERROR(first, "range %d has no hybrid buffer", i);
+            return NULL;
+        }
+
+        if (hBuffer->gpuBuff.device != first->gpuBuff.device) {
+            ERROR(first, "range %d belongs to a different device", i);
+            return NULL;
+        }
+
+        // the copies only cover the vulkan buffers, not the allocations
+        uint64_t size = hBuffer->gpuBuff.bufSize;
+        uint64_t offset = ranges[i].offset;
+        if (offset > size || ranges[i].size > size - offset) {
+            ERROR(hBuffer, "range %d: offset + size > buffer size", i);
+            return NULL;
+        }
+    }
+
+    return first->gpuBuff.device;
+}
+
+static void mc_hybrid_buffer_record_copies(
+    VkCommandBuffer cmdBuff,
+    uint32_t count,
+    mc_HBufferRange* ranges,
+    bool upload
+) {
+    for (uint32_t i = 0; i < count; i++) {
+        mc_HBuffer* hBuffer = ranges[i].hBuffer;
+        if (ranges[i].size == 0 || !hBuffer->cpuBuff) continue;
+
+        VkBufferCopy region = {0};
+        region.srcOffset = ranges[i].offset;
+        region.dstOffset = ranges[i].offset;
+        region.size = ranges[i].size;
+
+        vkCmdCopyBuffer(
+            cmdBuff,
+            upload ? hBuffer->cpuBuff->buf : hBuffer->gpuBuff.buf,
+            upload ? hBuffer->gpuBuff.buf : hBuffer->cpuBuff->buf,
+            1,
+            &region
+        );
+    }
+
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = upload ? VK_ACCESS_SHADER_READ_BIT
+                                       | VK_ACCESS_SHADER_WRITE_BIT
+                                   : VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        cmdBuff,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        upload ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+               : VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        NULL,
+        0,
+        NULL
+    );
+}
+
+// the mapped memory of a hybrid buffer, the GPU side itself on unified memory
+static char* mc_hybrid_buffer_get_map(mc_HBuffer* hBuffer) {
+    mc_Buffer* buffer = hBuffer->cpuBuff ? hBuffer->cpuBuff : &hBuffer->gpuBuff;
+    return buffer->map;
+}
+
+static bool mc_hybrid_buffer_need_copies(
+    uint32_t count,
+    mc_HBufferRange* ranges
+) {
+    for (uint32_t i = 0; i < count; i++)
+        if (ranges[i].hBuffer->cpuBuff) return true;
+    return false;
+}
+
+uint64_t mc_hybrid_buffer_write_many(uint32_t count, mc_HBufferRange* ranges) {
+    mc_Device* device = mc_hybrid_buffer_check_ranges(count, ranges);
+    if (!device) return 0;
+    DEBUG(device, "writing %d hybrid buffer range(s)", count);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        char* map = mc_hybrid_buffer_get_map(ranges[i].hBuffer);
+        memcpy(map + ranges[i].offset, ranges[i].data, ranges[i].size);
+        total += ranges[i].size;
+    }
+
+    if (!mc_hybrid_buffer_need_copies(count, ranges)) return total;
+
+    VkCommandBuffer cmdBuff = mc_device_begin_commands(device);
+    if (!cmdBuff) return 0;
+
+    mc_hybrid_buffer_record_copies(cmdBuff, count, ranges, true);
+
+    return mc_device_submit_commands(device, cmdBuff) ? total : 0;
+}
+
+uint64_t mc_hybrid_buffer_read_many(uint32_t count, mc_HBufferRange* ranges) {
+    mc_Device* device = mc_hybrid_buffer_check_ranges(count, ranges);
+    if (!device) return 0;
+    DEBUG(device, "reading %d hybrid buffer range(s)", count);
+
+    if (mc_hybrid_buffer_need_copies(count, ranges)) {
+        VkCommandBuffer cmdBuff = mc_device_begin_commands(device);
+        if (!cmdBuff) return 0;
+
+        mc_hybrid_buffer_record_copies(cmdBuff, count, ranges, false);
+
+        if (!mc_device_submit_commands(device, cmdBuff)) return 0;
+    }
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        char* map = mc_hybrid_buffer_get_map(ranges[i].hBuffer);
+        memcpy(ranges[i].data, map + ranges[i].offset, ranges[i].size);
+        total += ranges[i].size;
+    }
+
+    return total;
+}
\ No newline at end of file
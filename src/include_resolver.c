@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include_resolver.h"
+#include "instance.h"
+#include "log.h"
+#include "misc.h"
+
+typedef struct mc_IncludeResult {
+    shaderc_include_result result;
+    char* name;
+    char* content;
+} mc_IncludeResult;
+
+static char* mc_join_path(const char* dir, size_t dirLen, const char* file) {
+    char* path = malloc(dirLen + strlen(file) + 2);
+    memcpy(path, dir, dirLen);
+    path[dirLen] = '/';
+    memcpy(path + dirLen + 1, file, strlen(file) + 1);
+    return path;
+}
+
+static void mc_include_resolver_add_dep(
+    mc_IncludeResolver* resolver,
+    const char* path,
+    const char* content,
+    size_t size
+) {
+    for (uint32_t i = 0; i < resolver->depCount; i++)
+        if (strcmp(resolver->deps[i], path) == 0) return;
+
+    uint32_t idx = resolver->depCount++;
+    resolver->deps
+        = realloc(resolver->deps, sizeof *resolver->deps * resolver->depCount);
+    resolver->depHashes = realloc(
+        resolver->depHashes,
+        sizeof *resolver->depHashes * resolver->depCount
+    );
+
+    resolver->deps[idx] = malloc(strlen(path) + 1);
+    memcpy(resolver->deps[idx], path, strlen(path) + 1);
+    resolver->depHashes[idx] = mc_hash(MC_HASH_SEED, content, size);
+}
+
+const char* mc_include_resolver_dir(const char* name, size_t* len) {
+    const char* slash = strrchr(name, '/');
+    const char* bslash = strrchr(name, '\\');
+    if (bslash > slash) slash = bslash;
+
+    if (!slash) {
+        *len = 1;
+        return ".";
+    }
+
+    *len = slash - name;
+    return name;
+}
+
+static shaderc_include_result* mc_include_resolve(
+    void* arg,
+    const char* requested,
+    int type,
+    const char* requesting,
+    size_t depth
+) {
+    mc_IncludeResolver* resolver = arg;
+    mc_Instance* instance = resolver->_instance;
+
+    mc_IncludeResult* res = malloc(sizeof *res);
+    *res = (mc_IncludeResult){.name = NULL, .content = NULL};
+
+    size_t size = 0;
+
+    // "file" is looked up next to the including file first, then <file> and
+    // "file" are looked up in the include paths, in order
+    if (type == shaderc_include_type_relative) {
+        size_t dirLen;
+        const char* dir = mc_include_resolver_dir(requesting, &dirLen);
+        res->name = mc_join_path(dir, dirLen, requested);
+        res->content = mc_read_file(res->name, &size);
+        if (!res->content) {
+            free(res->name);
+            res->name = NULL;
+        }
+    }
+
+    for (uint32_t i = 0; !res->content && i < instance->includePathCount; i++) {
+        const char* dir = instance->includePaths[i];
+        res->name = mc_join_path(dir, strlen(dir), requested);
+        res->content = mc_read_file(res->name, &size);
+        if (!res->content) {
+            free(res->name);
+            res->name = NULL;
+        }
+    }
+
+    if (res->content) {
+        DEBUG(resolver, "- including \"%s\"", res->name);
+        mc_include_resolver_add_dep(resolver, res->name, res->content, size);
+        res->result.source_name = res->name;
+        res->result.source_name_length = strlen(res->name);
+        res->result.content = res->content;
+        res->result.content_length = size;
+    } else {
+        // an empty name signals an error, the content is the error message
+        const char* fmt = "failed to find include file \"%s\"";
+        size_t len = snprintf(NULL, 0, fmt, requested);
+        res->content = malloc(len + 1);
+        snprintf(res->content, len + 1, fmt, requested);
+        res->result.source_name = "";
+        res->result.source_name_length = 0;
+        res->result.content = res->content;
+        res->result.content_length = len;
+    }
+
+    res->result.user_data = res;
+    return &res->result;
+}
+
+static void mc_include_release(void* arg, shaderc_include_result* result) {
+    mc_IncludeResult* res = result->user_data;
+    free(res->name);
+    free(res->content);
+    free(res);
+}
+
+void mc_include_resolver_init(
+    mc_IncludeResolver* resolver,
+    mc_Instance* instance,
+    shaderc_compile_options_t options
+) {
+    *resolver = (mc_IncludeResolver){
+        ._instance = instance,
+        .depCount = 0,
+        .deps = NULL,
+        .depHashes = NULL,
+    };
+
+    shaderc_compile_options_set_include_callbacks(
+        options,
+        mc_include_resolve,
+        mc_include_release,
+        resolver
+    );
+}
+
+void mc_include_resolver_clear(mc_IncludeResolver* resolver) {
+    for (uint32_t i = 0; i < resolver->depCount; i++) free(resolver->deps[i]);
+    free(resolver->deps);
+    free(resolver->depHashes);
+    resolver->depCount = 0;
+    resolver->deps = NULL;
+    resolver->depHashes = NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef MC_INCLUDE_RESOLVER_H
+#define MC_INCLUDE_RESOLVER_H
+
+#include <shaderc/shaderc.h>
+
+#include "microcompute.h"
+
+// resolves `#include`s for a single compilation, and records every file that
+// was included (with a hash of its contents)
+typedef struct mc_IncludeResolver {
+    mc_Instance* _instance;
+    uint32_t depCount;
+    char** deps;
+    uint64_t* depHashes;
+} mc_IncludeResolver;
+
+void mc_include_resolver_init(
+    mc_IncludeResolver* resolver,
+    mc_Instance* instance,
+    shaderc_compile_options_t options
+);
+
+void mc_include_resolver_clear(mc_IncludeResolver* resolver);
+
+// the directory `"file"` includes of `name` are resolved against, `len` is set
+// to the length of the directory part
+const char* mc_include_resolver_dir(const char* name, size_t* len);
+
+#endif // MC_INCLUDE_RESOLVER_H
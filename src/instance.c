@@ -1,10 +1,22 @@
 #include <stdlib.h>
+#include <string.h>
 #include <vulkan/vulkan.h>
 
+#ifdef MC_WITH_SHADERC
+#include <shaderc/shaderc.h>
+#endif
+
 #include "device.h"
 #include "instance.h"
 #include "log.h"
 
+static const mc_CompileOptions mc_default_compile_options = {
+    .vulkanVersion = MC_VULKAN_VERSION(1, 0),
+    .spirvVersion = 0,
+    .optimizationLevel = MC_OPTIMIZATION_LEVEL_PERFORMANCE,
+    .debugInfo = false,
+};
+
 static VkBool32 mc_vk_log_callback(
     VkDebugUtilsMessageSeverityFlagBitsEXT severity,
     VkDebugUtilsMessageTypeFlagsEXT type,
@@ -25,69 +37,134 @@ static VkBool32 mc_vk_log_callback(
     return VK_FALSE;
 }
 
+static bool mc_has_validation_layer() {
+    uint32_t layerCount = 0;
+    if (vkEnumerateInstanceLayerProperties(&layerCount, NULL)) return false;
+
+    VkLayerProperties* layers = malloc(sizeof *layers * (layerCount + 1));
+    if (vkEnumerateInstanceLayerProperties(&layerCount, layers)) {
+        free(layers);
+        return false;
+    }
+
+    bool found = false;
+    for (uint32_t i = 0; i < layerCount && !found; i++)
+        found = !strcmp(layers[i].layerName, "VK_LAYER_KHRONOS_validation");
+
+    free(layers);
+    return found;
+}
+
 mc_Instance* mc_instance_create(mc_log_fn* log_fn, void* logArg) {
+    return mc_instance_create_with_flags(log_fn, logArg, MC_INSTANCE_FLAG_NONE);
+}
+
+mc_Instance* mc_instance_create_with_flags(
+    mc_log_fn* log_fn,
+    void* logArg,
+    uint32_t flags
+) {
     mc_Instance* instance = malloc(sizeof *instance);
     *instance = (mc_Instance){
         ._instance = instance,
         .logArg = logArg,
         .log_fn = log_fn ? log_fn : mc_log_cb_sink,
+        .flags = flags,
+        .apiVersion = VK_API_VERSION_1_0,
         .instance = NULL,
         .devCount = 0,
         .devs = NULL,
         .msg = NULL,
+        .cacheDir = NULL,
+        .includePathCount = 0,
+        .includePaths = NULL,
+        .compilerLock = mc_mutex_create(),
+        .compileSettings = mc_default_compile_options,
+        .compiler = NULL,
+        .compileOptions = NULL,
     };
 
     DEBUG(instance, "initializing instance");
 
+    // ask for the highest version we know (1.3), devices are used at the
+    // lower of their version and this one, older loaders only know 1.0
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    PFN_vkEnumerateInstanceVersion enumerate_version
+        = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+            NULL,
+            "vkEnumerateInstanceVersion"
+        );
+    if (enumerate_version) enumerate_version(&loaderVersion);
+    loaderVersion &= ~0xfffu; // drop the patch version
+    instance->apiVersion = loaderVersion < VK_API_VERSION_1_3
+                             ? loaderVersion
+                             : VK_API_VERSION_1_3;
+
     VkApplicationInfo appI = {0};
     appI.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     appI.pApplicationName = "microcompute";
-    appI.apiVersion = VK_MAKE_VERSION(1, 0, 0);
-
-    DEBUG(instance, "enabling vulkan validation layer");
-
-    VkDebugUtilsMessengerCreateInfoEXT msgI = {0};
-    msgI.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    msgI.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
-                         | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
-                         | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
-                         | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-    msgI.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
-                     | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
-                     | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    msgI.pfnUserCallback = mc_vk_log_callback;
-    msgI.pUserData = instance;
+    appI.apiVersion = instance->apiVersion;
 
     VkInstanceCreateInfo instanceI = {0};
     instanceI.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     instanceI.pApplicationInfo = &appI;
-    instanceI.pNext = &msgI;
-    instanceI.enabledLayerCount = 1;
-    instanceI.ppEnabledLayerNames = (const char*[]){
-        "VK_LAYER_KHRONOS_validation",
-    };
-    instanceI.enabledExtensionCount = 1;
-    instanceI.ppEnabledExtensionNames = (const char*[]){
-        "VK_EXT_debug_utils",
-    };
+
+    if ((flags & MC_INSTANCE_FLAG_VALIDATION) && !mc_has_validation_layer()) {
+        WARN(instance, "vulkan validation layer not found, continuing without");
+        instance->flags &= ~MC_INSTANCE_FLAG_VALIDATION;
+    }
+
+    VkDebugUtilsMessengerCreateInfoEXT msgI = {0};
+    if (instance->flags & MC_INSTANCE_FLAG_VALIDATION) {
+        DEBUG(instance, "enabling vulkan validation layer");
+
+        msgI.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        msgI.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT
+                             | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
+                             | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
+                             | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        msgI.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT
+                         | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT
+                         | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        msgI.pfnUserCallback = mc_vk_log_callback;
+        msgI.pUserData = instance;
+
+        // the layer provides the debug utils extension
+        instanceI.pNext = &msgI;
+        instanceI.enabledLayerCount = 1;
+        instanceI.ppEnabledLayerNames = (const char*[]){
+            "VK_LAYER_KHRONOS_validation",
+        };
+        instanceI.enabledExtensionCount = 1;
+        instanceI.ppEnabledExtensionNames = (const char*[]){
+            "VK_EXT_debug_utils",
+        };
+    }
 
     if (vkCreateInstance(&instanceI, NULL, &instance->instance)) {
         ERROR(instance, "failed to create vulkan instance");
-        ERROR(instance, "make sure vulkan validation layers are installed");
         mc_instance_destroy(instance);
         return NULL;
     }
 
-    uint32_t v;
-    vkEnumerateInstanceVersion(&v);
-    DEBUG(instance, "vulkan %d.%d", VK_VERSION_MAJOR(v), VK_VERSION_MINOR(v));
-
-    PFN_vkCreateDebugUtilsMessengerEXT msg_create
-        = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
-            instance->instance,
-            "vkCreateDebugUtilsMessengerEXT"
-        );
-    if (msg_create) msg_create(instance->instance, &msgI, NULL, &instance->msg);
+    DEBUG(
+        instance,
+        "vulkan %d.%d, using %d.%d",
+        VK_API_VERSION_MAJOR(loaderVersion),
+        VK_API_VERSION_MINOR(loaderVersion),
+        VK_API_VERSION_MAJOR(instance->apiVersion),
+        VK_API_VERSION_MINOR(instance->apiVersion)
+    );
+
+    if (instance->flags & MC_INSTANCE_FLAG_VALIDATION) {
+        PFN_vkCreateDebugUtilsMessengerEXT msg_create
+            = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(
+                instance->instance,
+                "vkCreateDebugUtilsMessengerEXT"
+            );
+        if (msg_create)
+            msg_create(instance->instance, &msgI, NULL, &instance->msg);
+    }
 
     uint32_t pDevCount = 0;
     if (vkEnumeratePhysicalDevices(instance->instance, &pDevCount, NULL)) {
@@ -178,6 +255,16 @@ void mc_instance_destroy(mc_Instance* instance) {
     }
 
     if (instance->instance) vkDestroyInstance(instance->instance, NULL);
+    if (instance->cacheDir) free(instance->cacheDir);
+    for (uint32_t i = 0; i < instance->includePathCount; i++)
+        free(instance->includePaths[i]);
+    if (instance->includePaths) free(instance->includePaths);
+#ifdef MC_WITH_SHADERC
+    if (instance->compileOptions)
+        shaderc_compile_options_release(instance->compileOptions);
+    if (instance->compiler) shaderc_compiler_release(instance->compiler);
+#endif
+    mc_mutex_destroy(instance->compilerLock);
     free(instance);
 }
 
@@ -188,3 +275,173 @@ uint32_t mc_instance_get_device_count(mc_Instance* instance) {
 mc_Device** mc_instance_get_devices(mc_Instance* instance) {
     return instance ? instance->devs : NULL;
 }
+
+static bool mc_device_matches(
+    mc_Device* device,
+    const mc_DeviceCriteria* criteria
+) {
+    const mc_DeviceInfo* info = &device->info;
+    uint32_t typeBit = MC_DEVICE_TYPE_BIT(device->type);
+
+    if (criteria->requiredTypes && !(criteria->requiredTypes & typeBit))
+        return false;
+    if (info->deviceLocalMemory < criteria->minMemory) return false;
+    if ((info->features & criteria->requiredFeatures)
+        != criteria->requiredFeatures)
+        return false;
+    if (criteria->vendorId && info->vendorId != criteria->vendorId)
+        return false;
+    return true;
+}
+
+// rough throughput order of the device types, higher is faster
+static uint32_t mc_device_type_rank(mc_DeviceType type) {
+    switch (type) {
+        case MC_DEVICE_TYPE_DGPU: return 4;
+        case MC_DEVICE_TYPE_IGPU: return 3;
+        case MC_DEVICE_TYPE_VGPU: return 2;
+        case MC_DEVICE_TYPE_OTHER: return 1;
+        default: return 0;
+    }
+}
+
+// `true` if device `a` is expected to be faster than device `b`
+static bool mc_device_ranks_before(
+    mc_Device* a,
+    mc_Device* b,
+    const mc_DeviceCriteria* criteria
+) {
+    bool aPreferred = criteria->preferredTypes & MC_DEVICE_TYPE_BIT(a->type);
+    bool bPreferred = criteria->preferredTypes & MC_DEVICE_TYPE_BIT(b->type);
+    if (aPreferred != bPreferred) return aPreferred;
+
+    uint32_t aRank = mc_device_type_rank(a->type);
+    uint32_t bRank = mc_device_type_rank(b->type);
+    if (aRank != bRank) return aRank > bRank;
+
+    return a->info.deviceLocalMemory > b->info.deviceLocalMemory;
+}
+
+uint32_t mc_instance_select_devices(
+    mc_Instance* instance,
+    const mc_DeviceCriteria* criteria,
+    mc_Device** devs
+) {
+    if (!instance) return 0;
+    if (!devs) return 0;
+
+    mc_DeviceCriteria any = {0};
+    if (!criteria) criteria = &any;
+
+    // insertion sort, there are only a few devices and it keeps the order of
+    // equally ranked ones
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < instance->devCount; i++) {
+        mc_Device* device = instance->devs[i];
+        if (!mc_device_matches(device, criteria)) continue;
+
+        uint32_t idx = count++;
+        for (; idx > 0; idx--) {
+            if (!mc_device_ranks_before(device, devs[idx - 1], criteria)) break;
+            devs[idx] = devs[idx - 1];
+        }
+        devs[idx] = device;
+    }
+
+    return count;
+}
+
+mc_Device* mc_instance_select_device(
+    mc_Instance* instance,
+    const mc_DeviceCriteria* criteria
+) {
+    if (!instance) return NULL;
+    if (instance->devCount == 0) return NULL;
+
+    mc_Device** devs = malloc(sizeof *devs * instance->devCount);
+    uint32_t count = mc_instance_select_devices(instance, criteria, devs);
+    mc_Device* device = count > 0 ? devs[0] : NULL;
+    free(devs);
+
+    if (!device) WARN(instance, "no device matches the criteria");
+    return device;
+}
+
+void mc_instance_set_cache_dir(mc_Instance* instance, const char* dir) {
+    if (!instance) return;
+    DEBUG(instance, "setting cache directory to %s", dir ? dir : "(none)");
+
+    if (instance->cacheDir) free(instance->cacheDir);
+    instance->cacheDir = NULL;
+
+    if (dir) instance->cacheDir = mc_copy_str(dir);
+}
+
+bool mc_instance_set_compile_options(
+    mc_Instance* instance,
+    const mc_CompileOptions* options
+) {
+    if (!instance) return false;
+
+    mc_CompileOptions settings
+        = options ? *options : mc_default_compile_options;
+
+    DEBUG(
+        instance,
+        "setting compile options: vulkan %d.%d, spir-v %d.%d, optimization "
+        "level %d, debug info %s",
+        settings.vulkanVersion >> 22,
+        (settings.vulkanVersion >> 12) & 0x3ff,
+        settings.spirvVersion >> 16,
+        (settings.spirvVersion >> 8) & 0xff,
+        settings.optimizationLevel,
+        settings.debugInfo ? "on" : "off"
+    );
+
+    if (settings.vulkanVersion < MC_VULKAN_VERSION(1, 0)
+        || settings.vulkanVersion > MC_VULKAN_VERSION(1, 3)
+        || (settings.vulkanVersion & 0xfff)) {
+        ERROR(instance, "unsupported target vulkan version");
+        return false;
+    }
+
+    if (settings.spirvVersion
+        && (settings.spirvVersion < MC_SPIRV_VERSION(1, 0)
+            || settings.spirvVersion > MC_SPIRV_VERSION(1, 6)
+            || (settings.spirvVersion & 0xff))) {
+        ERROR(instance, "unsupported target SPIR-V version");
+        return false;
+    }
+
+    if (settings.optimizationLevel > MC_OPTIMIZATION_LEVEL_PERFORMANCE) {
+        ERROR(instance, "unknown optimization level");
+        return false;
+    }
+
+    mc_mutex_lock(instance->compilerLock);
+    instance->compileSettings = settings;
+    mc_mutex_unlock(instance->compilerLock);
+    return true;
+}
+
+mc_CompileOptions mc_instance_get_compile_options(mc_Instance* instance) {
+    if (!instance) return mc_default_compile_options;
+
+    mc_mutex_lock(instance->compilerLock);
+    mc_CompileOptions settings = instance->compileSettings;
+    mc_mutex_unlock(instance->compilerLock);
+    return settings;
+}
+
+void mc_instance_add_include_path(mc_Instance* instance, const char* path) {
+    if (!instance || !path) return;
+    DEBUG(instance, "adding include path %s", path);
+
+    uint32_t idx = instance->includePathCount++;
+    instance->includePaths = realloc(
+        instance->includePaths,
+        sizeof *instance->includePaths * instance->includePathCount
+    );
+
+    instance->includePaths[idx] = mc_copy_str(path);
+}
@@ -4,15 +4,27 @@
 #include <vulkan/vulkan.h>
 
 #include "microcompute.h"
+#include "misc.h"
 
 struct mc_Instance {
     mc_Instance* _instance;
     void* logArg;
     mc_log_fn* log_fn;
+    uint32_t flags; // `mc_InstanceFlags` actually in use
+    uint32_t apiVersion; // the vulkan version the instance was created with
     VkInstance instance;
     uint32_t devCount;
     mc_Device** devs;
     VkDebugUtilsMessengerEXT msg;
+    char* cacheDir;
+    uint32_t includePathCount;
+    char** includePaths;
+    mc_Mutex* compilerLock; // also guards `compileSettings`
+    mc_CompileOptions compileSettings;
+    // shaderc handles, the struct types keep this header (and the layout of
+    // the instance) independent of MC_WITH_SHADERC
+    struct shaderc_compiler* compiler;
+    struct shaderc_compile_options* compileOptions;
 };
 
 #endif // MC_INSTANCE_H
@@ -1,14 +1,134 @@
+#include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "microcompute.h"
+#include "misc.h"
 
 #ifdef _WIN32
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <direct.h>
+
+struct mc_Mutex {
+    CRITICAL_SECTION cs;
+};
+
+mc_Mutex* mc_mutex_create() {
+    mc_Mutex* mutex = malloc(sizeof *mutex);
+    InitializeCriticalSection(&mutex->cs);
+    return mutex;
+}
+
+void mc_mutex_destroy(mc_Mutex* mutex) {
+    if (!mutex) return;
+    DeleteCriticalSection(&mutex->cs);
+    free(mutex);
+}
+
+void mc_mutex_lock(mc_Mutex* mutex) {
+    EnterCriticalSection(&mutex->cs);
+}
+
+void mc_mutex_unlock(mc_Mutex* mutex) {
+    LeaveCriticalSection(&mutex->cs);
+}
+
+struct mc_Thread {
+    HANDLE handle;
+    mc_thread_fn* fn;
+    void* arg;
+};
+
+static DWORD WINAPI mc_thread_main(LPVOID arg) {
+    mc_Thread* thread = arg;
+    thread->fn(thread->arg);
+    return 0;
+}
+
+mc_Thread* mc_thread_create(mc_thread_fn* fn, void* arg) {
+    mc_Thread* thread = malloc(sizeof *thread);
+    *thread = (mc_Thread){.handle = NULL, .fn = fn, .arg = arg};
+    thread->handle = CreateThread(NULL, 0, mc_thread_main, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void mc_thread_join(mc_Thread* thread) {
+    if (!thread) return;
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+uint32_t mc_get_cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+void mc_sleep(double seconds) {
+    Sleep((DWORD)(seconds * 1000.0));
+}
+
+struct mc_MappedFile {
+    HANDLE file;
+    HANDLE mapping;
+    void* data;
+};
+
+mc_MappedFile* mc_map_file(const char* path, const void** data, size_t* size) {
+    mc_MappedFile* mapped = malloc(sizeof *mapped);
+    *mapped = (mc_MappedFile){.file = NULL, .mapping = NULL, .data = NULL};
+
+    mapped->file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+
+    LARGE_INTEGER fileSize;
+    if (mapped->file == INVALID_HANDLE_VALUE
+        || !GetFileSizeEx(mapped->file, &fileSize) || fileSize.QuadPart == 0) {
+        if (mapped->file != INVALID_HANDLE_VALUE) CloseHandle(mapped->file);
+        free(mapped);
+        return NULL;
+    }
+
+    mapped->mapping
+        = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapped->mapping)
+        mapped->data = MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (!mapped->data) {
+        if (mapped->mapping) CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        free(mapped);
+        return NULL;
+    }
+
+    *data = mapped->data;
+    *size = (size_t)fileSize.QuadPart;
+    return mapped;
+}
+
+void mc_unmap_file(mc_MappedFile* mapped) {
+    if (!mapped) return;
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+    free(mapped);
+}
 
 double mc_get_time() {
     SYSTEMTIME st;
@@ -25,9 +145,120 @@ double mc_get_time() {
     return (double)(1000000 * sec + usec) / 1000000.0;
 }
 
+static int mc_get_pid() {
+    return (int)GetCurrentProcessId();
+}
+
+static bool mc_make_dir(const char* path) {
+    // "C:" can't be created, but doesn't need to be
+    size_t len = strlen(path);
+    if (len == 2 && path[1] == ':') return true;
+    return _mkdir(path) == 0 || errno == EEXIST;
+}
+
 #else
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
+
+struct mc_Mutex {
+    pthread_mutex_t mtx;
+};
+
+mc_Mutex* mc_mutex_create() {
+    mc_Mutex* mutex = malloc(sizeof *mutex);
+    pthread_mutex_init(&mutex->mtx, NULL);
+    return mutex;
+}
+
+void mc_mutex_destroy(mc_Mutex* mutex) {
+    if (!mutex) return;
+    pthread_mutex_destroy(&mutex->mtx);
+    free(mutex);
+}
+
+void mc_mutex_lock(mc_Mutex* mutex) {
+    pthread_mutex_lock(&mutex->mtx);
+}
+
+void mc_mutex_unlock(mc_Mutex* mutex) {
+    pthread_mutex_unlock(&mutex->mtx);
+}
+
+struct mc_Thread {
+    pthread_t thread;
+    mc_thread_fn* fn;
+    void* arg;
+};
+
+static void* mc_thread_main(void* arg) {
+    mc_Thread* thread = arg;
+    thread->fn(thread->arg);
+    return NULL;
+}
+
+mc_Thread* mc_thread_create(mc_thread_fn* fn, void* arg) {
+    mc_Thread* thread = malloc(sizeof *thread);
+    *thread = (mc_Thread){.fn = fn, .arg = arg};
+    if (pthread_create(&thread->thread, NULL, mc_thread_main, thread)) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void mc_thread_join(mc_Thread* thread) {
+    if (!thread) return;
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
+
+uint32_t mc_get_cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
+
+void mc_sleep(double seconds) {
+    usleep((useconds_t)(seconds * 1000000.0));
+}
+
+struct mc_MappedFile {
+    void* data;
+    size_t size;
+};
+
+mc_MappedFile* mc_map_file(const char* path, const void** data, size_t* size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // the mapping stays valid after the file is closed
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return NULL;
+
+    mc_MappedFile* mapped = malloc(sizeof *mapped);
+    *mapped = (mc_MappedFile){.data = addr, .size = st.st_size};
+
+    *data = mapped->data;
+    *size = mapped->size;
+    return mapped;
+}
+
+void mc_unmap_file(mc_MappedFile* mapped) {
+    if (!mapped) return;
+    munmap(mapped->data, mapped->size);
+    free(mapped);
+}
 
 double mc_get_time() {
     struct timeval tv;
@@ -35,8 +266,119 @@ double mc_get_time() {
     return (double)(1000000 * tv.tv_sec + tv.tv_usec) / 1000000.0;
 }
 
+static int mc_get_pid() {
+    return (int)getpid();
+}
+
+static bool mc_make_dir(const char* path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+#endif
+
+bool mc_make_dirs(const char* path) {
+    char* dir = mc_copy_str(path);
+    bool ok = true;
+
+    // create every parent first, the root (or a leading separator) is skipped
+    for (char* c = dir + 1; ok && *c; c++) {
+#ifdef _WIN32
+        if (*c != '/' && *c != '\\') continue;
+#else
+        if (*c != '/') continue;
+#endif
+        char sep = *c;
+        *c = '\0';
+        ok = mc_make_dir(dir);
+        *c = sep;
+    }
+
+    ok = ok && mc_make_dir(dir);
+    free(dir);
+    return ok;
+}
+
+char* mc_copy_str(const char* str) {
+    char* copy = malloc(strlen(str) + 1);
+    memcpy(copy, str, strlen(str) + 1);
+    return copy;
+}
+
+char* mc_read_file(const char* path, size_t* size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    long dataSize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (dataSize < 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    char* data = malloc(dataSize + 1);
+    if (fread(data, 1, dataSize, fp) != (size_t)dataSize) {
+        fclose(fp);
+        free(data);
+        return NULL;
+    }
+    fclose(fp);
+
+    data[dataSize] = '\0';
+    if (size) *size = dataSize;
+    return data;
+}
+
+bool mc_write_file_atomic(
+    const char* path,
+    const void* tag,
+    mc_write_fn* write_fn,
+    void* arg
+) {
+    const char* fmt = "%s.%d.%p.tmp";
+    int len = snprintf(NULL, 0, fmt, path, mc_get_pid(), tag);
+    char* tmpPath = malloc(len + 1);
+    snprintf(tmpPath, len + 1, fmt, path, mc_get_pid(), tag);
+
+    FILE* fp = fopen(tmpPath, "wb");
+    bool ok = fp && write_fn(fp, arg);
+    if (fp) ok = fclose(fp) == 0 && ok;
+
+#ifdef _WIN32
+    // rename doesn't replace existing files on windows
+    if (ok) remove(path);
 #endif
 
+    ok = ok && rename(tmpPath, path) == 0;
+    if (!ok) remove(tmpPath);
+
+    free(tmpPath);
+    return ok;
+}
+
+uint64_t mc_hash(uint64_t hash, const void* data, size_t size) {
+    // 64 bit FNV-1a
+    for (size_t i = 0; i < size; i++) {
+        hash ^= ((const unsigned char*)data)[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t mc_hash_str(uint64_t hash, const char* str) {
+    // include the terminator, so ("ab", "c") and ("a", "bc") differ
+    return mc_hash(hash, str, strlen(str) + 1);
+}
+
+bool mc_hash_file(const char* path, uint64_t* hash) {
+    size_t size;
+    char* data = mc_read_file(path, &size);
+    if (!data) return false;
+    *hash = mc_hash(MC_HASH_SEED, data, size);
+    free(data);
+    return true;
+}
+
 const char* mc_log_level_to_str(mc_LogLevel level) {
     switch (level) {
         case MC_LOG_LEVEL_DEBUG: return "MC_LOG_LEVEL_DEBUG";
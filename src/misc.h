@@ -1,4 +1,67 @@
 #ifndef MC_MISC_H
 #define MC_MISC_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define MC_HASH_SEED 0xcbf29ce484222325ull
+
+typedef struct mc_Mutex mc_Mutex;
+
+mc_Mutex* mc_mutex_create();
+
+void mc_mutex_destroy(mc_Mutex* mutex);
+
+void mc_mutex_lock(mc_Mutex* mutex);
+
+void mc_mutex_unlock(mc_Mutex* mutex);
+
+typedef struct mc_Thread mc_Thread;
+
+typedef void(mc_thread_fn)(void* arg);
+
+mc_Thread* mc_thread_create(mc_thread_fn* fn, void* arg);
+
+void mc_thread_join(mc_Thread* thread);
+
+uint32_t mc_get_cpu_count();
+
+void mc_sleep(double seconds);
+
+char* mc_copy_str(const char* str);
+
+char* mc_read_file(const char* path, size_t* size);
+
+// create a directory and all of its parents, directories that already exist
+// are fine
+bool mc_make_dirs(const char* path);
+
+typedef bool(mc_write_fn)(FILE* fp, void* arg);
+
+// write a file with `write_fn` into a temporary file that is then renamed over
+// `path`, so other processes never see a partially written file. `tag` tells
+// apart writers of the same path within the process (several threads, or
+// several instances)
+bool mc_write_file_atomic(
+    const char* path,
+    const void* tag,
+    mc_write_fn* write_fn,
+    void* arg
+);
+
+typedef struct mc_MappedFile mc_MappedFile;
+
+// map a whole file read-only, `NULL` if it can't be mapped (or is empty)
+mc_MappedFile* mc_map_file(const char* path, const void** data, size_t* size);
+
+void mc_unmap_file(mc_MappedFile* mapped);
+
+uint64_t mc_hash(uint64_t hash, const void* data, size_t size);
+
+uint64_t mc_hash_str(uint64_t hash, const char* str);
+
+bool mc_hash_file(const char* path, uint64_t* hash);
+
 #endif // MC_MISC_H
\ No newline at end of file
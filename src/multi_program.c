@@ -0,0 +1,373 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "device.h"
+#include "hybrid_buffer.h"
+#include "log.h"
+#include "misc.h"
+#include "multi_program.h"
+#include "program.h"
+#include "program_code.h"
+
+// weight of a new measurement against the previous rate of a device, so one
+// noisy run doesn't move the whole partition
+#define MC_MULTI_PROGRAM_SMOOTHING 0.5
+
+typedef struct mc_MultiTask {
+    mc_MultiProgram* multi;
+    uint32_t idx;
+    uint32_t dim[3];
+    uint32_t offset[3];
+    int32_t buffCount;
+    mc_Buffer** buffs;
+    double time;
+} mc_MultiTask;
+
+// split `total` slices in proportion to the measured rates, devices that were
+// never measured get the average rate of the others (or an equal share)
+static void mc_multi_program_partition(
+    mc_MultiProgram* multi,
+    uint64_t total
+) {
+    double known = 0.0;
+    uint32_t knownCount = 0;
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        if (multi->rates[i] <= 0.0) continue;
+        known += multi->rates[i];
+        knownCount++;
+    }
+    double fallback = knownCount ? known / knownCount : 1.0;
+
+    double sum = 0.0;
+    for (uint32_t i = 0; i < multi->devCount; i++)
+        sum += multi->rates[i] > 0.0 ? multi->rates[i] : fallback;
+
+    // round the running total, so the counts always add up to `total`
+    double acc = 0.0;
+    uint64_t start = 0;
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        acc += multi->rates[i] > 0.0 ? multi->rates[i] : fallback;
+        uint64_t end = i + 1 == multi->devCount
+                         ? total
+                         : (uint64_t)(total * acc / sum + 0.5);
+        multi->start[i] = start;
+        multi->count[i] = end - start;
+        start = end;
+    }
+}
+
+static void mc_multi_program_update_rates(
+    mc_MultiProgram* multi,
+    mc_MultiTask* tasks
+) {
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        if (!multi->count[i] || tasks[i].time <= 0.0) continue;
+
+        double rate = multi->count[i] / tasks[i].time;
+        if (multi->rates[i] > 0.0)
+            rate = MC_MULTI_PROGRAM_SMOOTHING * rate
+                 + (1.0 - MC_MULTI_PROGRAM_SMOOTHING) * multi->rates[i];
+        multi->rates[i] = rate;
+    }
+}
+
+static void mc_multi_task_run(void* arg) {
+    mc_MultiTask* task = arg;
+    mc_Program* program = task->multi->programs[task->idx];
+
+    // the workgroup offset goes at the start of the push constants
+    mc_program_set_push_constants(program, sizeof task->offset, task->offset);
+    task->time = mc_program_dispatch(
+        program,
+        task->dim[0],
+        task->dim[1],
+        task->dim[2],
+        task->buffCount,
+        task->buffs
+    );
+}
+
+mc_MultiProgram* mc_multi_program_create(
+    uint32_t devCount,
+    mc_Device** devs,
+    mc_ProgramCode* code
+) {
+    if (!devCount || !devs || !devs[0] || !code) return NULL;
+
+    mc_MultiProgram* multi = malloc(sizeof *multi);
+    *multi = (mc_MultiProgram){
+        ._instance = devs[0]->_instance,
+        .devCount = devCount,
+        .devs = malloc(sizeof *multi->devs * devCount),
+        .programs = calloc(devCount, sizeof *multi->programs),
+        .rates = calloc(devCount, sizeof *multi->rates),
+        .start = calloc(devCount, sizeof *multi->start),
+        .count = calloc(devCount, sizeof *multi->count),
+    };
+
+    DEBUG(multi, "creating multi-device program on %d device(s)", devCount);
+
+    if (code->pushConstantSize < 3 * sizeof(uint32_t)) {
+        ERROR(multi, "the push constants must start with a workgroup offset");
+        mc_multi_program_destroy(multi);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < devCount; i++) {
+        multi->devs[i] = devs[i];
+        multi->programs[i] = mc_program_create(devs[i], code);
+        if (!multi->programs[i]) {
+            ERROR(multi, "failed to create program for device %d", i);
+            mc_multi_program_destroy(multi);
+            return NULL;
+        }
+    }
+
+    return multi;
+}
+
+void mc_multi_program_destroy(mc_MultiProgram* multi) {
+    if (!multi) return;
+    DEBUG(multi, "destroying multi-device program");
+
+    for (uint32_t i = 0; i < multi->devCount; i++)
+        mc_program_destroy(multi->programs[i]);
+    free(multi->devs);
+    free(multi->programs);
+    free(multi->rates);
+    free(multi->start);
+    free(multi->count);
+    free(multi);
+}
+
+uint32_t mc_multi_program_get_device_count(mc_MultiProgram* multi) {
+    if (!multi) return 0;
+    return multi->devCount;
+}
+
+double mc_multi_program_get_share(mc_MultiProgram* multi, uint32_t idx) {
+    if (!multi || idx >= multi->devCount) return 0.0;
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < multi->devCount; i++) total += multi->count[i];
+    if (!total) return 0.0;
+    return (double)multi->count[idx] / total;
+}
+
+uint32_t mc_multi_program_set_push_constants(
+    mc_MultiProgram* multi,
+    uint32_t size,
+    const void* data
+) {
+    if (!multi) return 0;
+
+    for (uint32_t i = 0; i < multi->devCount; i++)
+        if (mc_program_set_push_constants(multi->programs[i], size, data)
+            != size)
+            return 0;
+    return size;
+}
+
+double mc_multi_program_run__(
+    mc_MultiProgram* multi,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    ...
+) {
+    if (!multi) return -1.0;
+    DEBUG(multi, "running %dx%dx%d multi-device program", dimX, dimY, dimZ);
+
+    if (dimX * dimY * dimZ == 0) {
+        ERROR(multi, "at least one dimension is 0");
+        return -1.0;
+    }
+
+    // collect the buffers
+    int32_t buffCount = 0;
+    va_list args;
+    va_start(args, dimZ);
+    while (va_arg(args, mc_MultiBuffer*)) buffCount++;
+    va_end(args);
+
+    mc_MultiBuffer** mBuffs = malloc(sizeof *mBuffs * (buffCount + 1));
+    va_start(args, dimZ);
+    for (int32_t i = 0; i < buffCount; i++)
+        mBuffs[i] = va_arg(args, mc_MultiBuffer*);
+    va_end(args);
+
+    for (int32_t i = 0; i < buffCount; i++) {
+        if (mBuffs[i]->multi != multi) {
+            ERROR(multi, "buffer %d belongs to another program", i);
+            free(mBuffs);
+            return -1.0;
+        }
+    }
+
+    // split along y for 2D ranges, along x otherwise
+    uint32_t axis = dimY > 1 ? 1 : 0;
+    uint32_t dim[3] = {dimX, dimY, dimZ};
+    mc_multi_program_partition(multi, dim[axis]);
+
+    mc_MultiTask* tasks = calloc(multi->devCount, sizeof *tasks);
+    mc_Thread** threads = calloc(multi->devCount, sizeof *threads);
+    uint32_t activeCount = 0;
+
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        tasks[i] = (mc_MultiTask){
+            .multi = multi,
+            .idx = i,
+            .dim = {dimX, dimY, dimZ},
+            .offset = {0, 0, 0},
+            .buffCount = buffCount,
+            .buffs = NULL,
+            .time = 0.0,
+        };
+        tasks[i].dim[axis] = multi->count[i];
+        tasks[i].offset[axis] = multi->start[i];
+        tasks[i].buffs = malloc(sizeof *tasks[i].buffs * (buffCount + 1));
+        for (int32_t j = 0; j < buffCount; j++)
+            tasks[i].buffs[j] = &mBuffs[j]->hBuffers[i]->gpuBuff;
+        if (multi->count[i]) activeCount++;
+    }
+
+    double startTime = mc_get_time();
+
+    // a single device (lavapipe, or a small range) doesn't need a thread
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        if (!multi->count[i]) continue;
+        if (activeCount > 1)
+            threads[i] = mc_thread_create(mc_multi_task_run, &tasks[i]);
+        if (!threads[i]) mc_multi_task_run(&tasks[i]);
+    }
+    for (uint32_t i = 0; i < multi->devCount; i++)
+        mc_thread_join(threads[i]);
+
+    double time = mc_get_time() - startTime;
+
+    bool failed = false;
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        if (multi->count[i] && tasks[i].time < 0.0) {
+            ERROR(multi, "failed to run program on device %d", i);
+            failed = true;
+        }
+    }
+
+    if (!failed) mc_multi_program_update_rates(multi, tasks);
+
+    for (uint32_t i = 0; i < multi->devCount; i++) free(tasks[i].buffs);
+    free(tasks);
+    free(threads);
+    free(mBuffs);
+    return failed ? -1.0 : time;
+}
+
+mc_MultiBuffer* mc_multi_buffer_create(
+    mc_MultiProgram* multi,
+    uint64_t size,
+    uint64_t sliceSize
+) {
+    if (!multi) return NULL;
+
+    mc_MultiBuffer* mBuffer = malloc(sizeof *mBuffer);
+    *mBuffer = (mc_MultiBuffer){
+        ._instance = multi->_instance,
+        .multi = multi,
+        .size = size,
+        .sliceSize = sliceSize,
+        .hBuffers = calloc(multi->devCount, sizeof *mBuffer->hBuffers),
+    };
+
+    DEBUG(mBuffer, "creating multi-device buffer of size %lu", size);
+
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        mBuffer->hBuffers[i] = mc_hybrid_buffer_create(multi->devs[i], size);
+        if (!mBuffer->hBuffers[i]) {
+            ERROR(mBuffer, "failed to create buffer on device %d", i);
+            mc_multi_buffer_destroy(mBuffer);
+            return NULL;
+        }
+    }
+
+    return mBuffer;
+}
+
+void mc_multi_buffer_destroy(mc_MultiBuffer* mBuffer) {
+    if (!mBuffer) return;
+    DEBUG(mBuffer, "destroying multi-device buffer");
+
+    for (uint32_t i = 0; i < mBuffer->multi->devCount; i++)
+        mc_hybrid_buffer_destroy(mBuffer->hBuffers[i]);
+    free(mBuffer->hBuffers);
+    free(mBuffer);
+}
+
+uint64_t mc_multi_buffer_get_size(mc_MultiBuffer* mBuffer) {
+    if (!mBuffer) return 0;
+    return mBuffer->size;
+}
+
+uint64_t mc_multi_buffer_write(
+    mc_MultiBuffer* mBuffer,
+    uint64_t offset,
+    uint64_t size,
+    void* data
+) {
+    if (!mBuffer) return 0;
+    DEBUG(mBuffer, "writing %ld bytes to multi-device buffer", size);
+
+    // every device gets everything, the next partition isn't known yet
+    mc_MultiProgram* multi = mBuffer->multi;
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        uint64_t res
+            = mc_hybrid_buffer_write(mBuffer->hBuffers[i], offset, size, data);
+        if (res != size) return 0;
+    }
+    return size;
+}
+
+uint64_t mc_multi_buffer_read(
+    mc_MultiBuffer* mBuffer,
+    uint64_t offset,
+    uint64_t size,
+    void* data
+) {
+    if (!mBuffer) return 0;
+    DEBUG(mBuffer, "reading %ld bytes from multi-device buffer", size);
+
+    mc_MultiProgram* multi = mBuffer->multi;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < multi->devCount; i++) total += multi->count[i];
+
+    // shared buffers, and split buffers before the first run, are the same on
+    // every device
+    if (!mBuffer->sliceSize || !total)
+        return mc_hybrid_buffer_read(mBuffer->hBuffers[0], offset, size, data);
+
+    // gather the slices from the devices that computed them, the last device
+    // also owns everything past the last slice
+    uint64_t readSize = 0;
+    for (uint32_t i = 0; i < multi->devCount; i++) {
+        if (!multi->count[i]) continue;
+
+        uint64_t lo = multi->start[i] * mBuffer->sliceSize;
+        uint64_t hi = (multi->start[i] + multi->count[i]) * mBuffer->sliceSize;
+        if (multi->start[i] + multi->count[i] == total) hi = mBuffer->size;
+
+        if (lo < offset) lo = offset;
+        if (hi > offset + size) hi = offset + size;
+        if (lo >= hi) continue;
+
+        uint64_t res = mc_hybrid_buffer_read(
+            mBuffer->hBuffers[i],
+            lo,
+            hi - lo,
+            (char*)data + (lo - offset)
+        );
+        if (res != hi - lo) return 0;
+        readSize += res;
+    }
+    return readSize;
+}
@@ -0,0 +1,25 @@
+#ifndef MC_MULTI_PROGRAM_H
+#define MC_MULTI_PROGRAM_H
+
+#include "microcompute.h"
+#include "microcompute_extra.h"
+
+struct mc_MultiProgram {
+    mc_Instance* _instance;
+    uint32_t devCount;
+    mc_Device** devs;
+    mc_Program** programs;
+    double* rates;   // measured slices per second, 0 before the first run
+    uint64_t* start; // the slices of the last run
+    uint64_t* count;
+};
+
+struct mc_MultiBuffer {
+    mc_Instance* _instance;
+    mc_MultiProgram* multi;
+    uint64_t size;
+    uint64_t sliceSize; // 0 for buffers that are the same on every device
+    mc_HBuffer** hBuffers;
+};
+
+#endif // MC_MULTI_PROGRAM_H
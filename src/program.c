@@ -10,6 +10,12 @@
 
 #include <program_code.h>
 
+static VkDescriptorType mc_binding_type_to_vk(mc_BindingType type) {
+    if (type == MC_BINDING_TYPE_UNIFORM_BUFFER)
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+}
+
 static void mc_program_clear(mc_Program* program) {
     DEBUG(program, "clearing program");
     VkDevice dev = program->device->dev;
@@ -21,33 +27,30 @@ static void mc_program_clear(mc_Program* program) {
         vkFreeDescriptorSets(dev, program->descPool, 1, &program->descSet);
     if (program->descPool) //
         vkDestroyDescriptorPool(dev, program->descPool, NULL);
-    if (program->pipeline) //
-        vkDestroyPipeline(dev, program->pipeline, NULL);
-    if (program->pipelineLayout)
-        vkDestroyPipelineLayout(dev, program->pipelineLayout, NULL);
-    if (program->descSetLayout)
-        vkDestroyDescriptorSetLayout(dev, program->descSetLayout, 0);
-}
-
-static void mc_program_setup(mc_Program* program) {
-    mc_program_clear(program);
 
-    DEBUG(program, "setting up program with %d buffer(s):", program->buffCount);
+    program->cmdBuff = NULL;
+    program->cmdPool = NULL;
+    program->descSet = NULL;
+    program->descPool = NULL;
+}
 
+// the layouts and the pipeline only depend on the code, so they are built once
+static bool mc_program_create_pipeline(mc_Program* program) {
     VkDescriptorSetLayoutBinding* descBindings
-        = malloc(sizeof *descBindings * program->buffCount);
+        = malloc(sizeof *descBindings * program->bindingCount);
 
-    for (int32_t i = 0; i < program->buffCount; i++) {
+    for (uint32_t i = 0; i < program->bindingCount; i++) {
+        mc_Binding* binding = &program->bindings[i];
         descBindings[i] = (VkDescriptorSetLayoutBinding){0};
-        descBindings[i].binding = i;
-        descBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descBindings[i].binding = binding->binding;
+        descBindings[i].descriptorType = mc_binding_type_to_vk(binding->type);
         descBindings[i].descriptorCount = 1;
         descBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     }
 
     VkDescriptorSetLayoutCreateInfo descLayoutInfo = {0};
     descLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    descLayoutInfo.bindingCount = program->buffCount;
+    descLayoutInfo.bindingCount = program->bindingCount;
     descLayoutInfo.pBindings = descBindings;
 
     if (vkCreateDescriptorSetLayout(
@@ -58,15 +61,22 @@ static void mc_program_setup(mc_Program* program) {
         )) {
         ERROR(program, "failed to create descriptor set layout");
         free(descBindings);
-        return;
+        return false;
     }
 
     free(descBindings);
 
+    VkPushConstantRange pushRange = {0};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = program->pushSize;
+
     VkPipelineLayoutCreateInfo pipelineInfo = {0};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineInfo.setLayoutCount = 1;
     pipelineInfo.pSetLayouts = &program->descSetLayout;
+    pipelineInfo.pushConstantRangeCount = program->pushSize ? 1 : 0;
+    pipelineInfo.pPushConstantRanges = &pushRange;
 
     if (vkCreatePipelineLayout(
             program->device->dev,
@@ -75,7 +85,7 @@ static void mc_program_setup(mc_Program* program) {
             &program->pipelineLayout
         )) {
         ERROR(program, "failed to create pipeline layout");
-        return;
+        return false;
     }
 
     VkPipelineShaderStageCreateInfo shaderStageInfo = {0};
@@ -98,19 +108,60 @@ static void mc_program_setup(mc_Program* program) {
             &program->pipeline
         )) {
         ERROR(program, "failed to create compute pipeline");
-        return;
+        return false;
+    }
+
+    return true;
+}
+
+static bool mc_program_record(mc_Program* program) {
+    VkCommandBufferBeginInfo cmdBuffBeginInfo = {0};
+    cmdBuffBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    // the pool allows resetting, so beginning again discards the old commands
+    if (vkBeginCommandBuffer(program->cmdBuff, &cmdBuffBeginInfo)) {
+        ERROR(program, "failed to begin command buffer");
+        return false;
+    }
+
+    mc_program_record_dispatch(program, program->cmdBuff, program->descSet);
+
+    if (vkEndCommandBuffer(program->cmdBuff)) {
+        ERROR(program, "failed to end command buffer");
+        return false;
+    }
+
+    return true;
+}
+
+static bool mc_program_setup(mc_Program* program) {
+    mc_program_clear(program);
+
+    DEBUG(program, "setting up program with %d buffer(s):", program->buffCount);
+
+    // every binding of the code needs a buffer, buffers past the last binding
+    // are ignored
+    for (uint32_t i = 0; i < program->bindingCount; i++) {
+        if ((int32_t)program->bindings[i].binding >= program->buffCount) {
+            ERROR(
+                program,
+                "no buffer passed for binding %d",
+                program->bindings[i].binding
+            );
+            return false;
+        }
     }
 
-    VkDescriptorPoolSize descPoolSize = {0};
-    descPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    descPoolSize.descriptorCount = program->buffCount;
+    VkDescriptorPoolSize descPoolSizes[2];
+    uint32_t descPoolSizeCount
+        = mc_program_get_pool_sizes(program, 1, descPoolSizes);
 
     VkDescriptorPoolCreateInfo descPoolInfo = {0};
     descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     descPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
     descPoolInfo.maxSets = 1;
-    descPoolInfo.poolSizeCount = 1;
-    descPoolInfo.pPoolSizes = &descPoolSize;
+    descPoolInfo.poolSizeCount = descPoolSizeCount;
+    descPoolInfo.pPoolSizes = descPoolSizes;
 
     if (vkCreateDescriptorPool(
             program->device->dev,
@@ -119,7 +170,7 @@ static void mc_program_setup(mc_Program* program) {
             &program->descPool
         )) {
         ERROR(program, "failed to create descriptor pool");
-        return;
+        return false;
     }
 
     VkDescriptorSetAllocateInfo descAllocInfo = {0};
@@ -134,7 +185,7 @@ static void mc_program_setup(mc_Program* program) {
             &program->descSet
         )) {
         ERROR(program, "failed to allocate descriptor sets");
-        return;
+        return false;
     }
 
     VkCommandPoolCreateInfo cmdPoolInfo = {0};
@@ -149,40 +200,15 @@ static void mc_program_setup(mc_Program* program) {
             &program->cmdPool
         )) {
         ERROR(program, "failed to create command pool");
-        return;
+        return false;
     }
 
-    VkDescriptorBufferInfo* descBuffInfo
-        = malloc(sizeof *descBuffInfo * program->buffCount);
-    VkWriteDescriptorSet* wrtDescSet
-        = malloc(sizeof *wrtDescSet * program->buffCount);
-
     for (int32_t i = 0; i < program->buffCount; i++) {
         mc_Buffer* buffer = program->buffs[i];
         DEBUG(program, "- buffer %d: size=%ld", i, mc_buffer_get_size(buffer));
-
-        descBuffInfo[i] = (VkDescriptorBufferInfo){0};
-        descBuffInfo[i].buffer = buffer->buf;
-        descBuffInfo[i].range = VK_WHOLE_SIZE;
-
-        wrtDescSet[i] = (VkWriteDescriptorSet){0};
-        wrtDescSet[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        wrtDescSet[i].dstSet = program->descSet;
-        wrtDescSet[i].dstBinding = i;
-        wrtDescSet[i].descriptorCount = 1;
-        wrtDescSet[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        wrtDescSet[i].pBufferInfo = &descBuffInfo[i];
     }
 
-    vkUpdateDescriptorSets(
-        program->device->dev,
-        program->buffCount,
-        wrtDescSet,
-        0,
-        NULL
-    );
-    free(descBuffInfo);
-    free(wrtDescSet);
+    mc_program_write_descriptors(program, program->descSet, program->buffs);
 
     VkCommandBufferAllocateInfo cmdBuffAllocInfo = {0};
     cmdBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -196,49 +222,134 @@ static void mc_program_setup(mc_Program* program) {
             &program->cmdBuff
         )) {
         ERROR(program, "failed to allocate command buffers");
-        return;
+        return false;
     }
 
-    VkCommandBufferBeginInfo cmdBuffBeginInfo = {0};
-    cmdBuffBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    return mc_program_record(program);
+}
 
-    if (vkBeginCommandBuffer(program->cmdBuff, &cmdBuffBeginInfo)) {
-        ERROR(program, "failed to begin command buffer");
-        return;
+uint32_t mc_program_get_pool_sizes(
+    mc_Program* program,
+    uint32_t setCount,
+    VkDescriptorPoolSize* sizes
+) {
+    uint32_t counts[2] = {0, 0};
+    for (uint32_t i = 0; i < program->bindingCount; i++)
+        counts[program->bindings[i].type == MC_BINDING_TYPE_UNIFORM_BUFFER]++;
+
+    // a pool size of 0 is not allowed, and a pool needs at least one size
+    uint32_t sizeCount = 0;
+    for (uint32_t i = 0; i < 2; i++) {
+        if (!counts[i] && (i || counts[1])) continue;
+        sizes[sizeCount] = (VkDescriptorPoolSize){0};
+        sizes[sizeCount].type = i ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                                  : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        sizes[sizeCount].descriptorCount
+            = (counts[i] ? counts[i] : 1) * setCount;
+        sizeCount++;
     }
 
+    return sizeCount;
+}
+
+void mc_program_write_descriptors(
+    mc_Program* program,
+    VkDescriptorSet descSet,
+    mc_Buffer** buffs
+) {
+    VkDescriptorBufferInfo* descBuffInfo
+        = malloc(sizeof *descBuffInfo * program->bindingCount);
+    VkWriteDescriptorSet* wrtDescSet
+        = malloc(sizeof *wrtDescSet * program->bindingCount);
+
+    for (uint32_t i = 0; i < program->bindingCount; i++) {
+        mc_Binding* binding = &program->bindings[i];
+
+        descBuffInfo[i] = (VkDescriptorBufferInfo){0};
+        descBuffInfo[i].buffer = buffs[binding->binding]->buf;
+        descBuffInfo[i].range = VK_WHOLE_SIZE;
+
+        wrtDescSet[i] = (VkWriteDescriptorSet){0};
+        wrtDescSet[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        wrtDescSet[i].dstSet = descSet;
+        wrtDescSet[i].dstBinding = binding->binding;
+        wrtDescSet[i].descriptorCount = 1;
+        wrtDescSet[i].descriptorType = mc_binding_type_to_vk(binding->type);
+        wrtDescSet[i].pBufferInfo = &descBuffInfo[i];
+    }
+
+    vkUpdateDescriptorSets(
+        program->device->dev,
+        program->bindingCount,
+        wrtDescSet,
+        0,
+        NULL
+    );
+    free(descBuffInfo);
+    free(wrtDescSet);
+}
+
+void mc_program_record_dispatch(
+    mc_Program* program,
+    VkCommandBuffer cmdBuff,
+    VkDescriptorSet descSet
+) {
     vkCmdBindPipeline(
-        program->cmdBuff,
+        cmdBuff,
         VK_PIPELINE_BIND_POINT_COMPUTE,
         program->pipeline
     );
 
     vkCmdBindDescriptorSets(
-        program->cmdBuff,
+        cmdBuff,
         VK_PIPELINE_BIND_POINT_COMPUTE,
         program->pipelineLayout,
         0,
         1,
-        &program->descSet,
+        &descSet,
         0,
         NULL
     );
 
-    vkCmdDispatch(
-        program->cmdBuff,
-        program->dim[0],
-        program->dim[1],
-        program->dim[2]
-    );
-    if (vkEndCommandBuffer(program->cmdBuff)) {
-        ERROR(program, "failed to end command buffer");
-        return;
+    if (program->pushSize)
+        vkCmdPushConstants(
+            cmdBuff,
+            program->pipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            program->pushSize,
+            program->pushData
+        );
+
+    vkCmdDispatch(cmdBuff, program->dim[0], program->dim[1], program->dim[2]);
+
+    // on unified memory the host reads the mapped GPU buffers right after the
+    // fence, waiting on it alone doesn't make the shader writes visible
+    if (program->device->unifiedMemory) {
+        VkMemoryBarrier barrier = {0};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            cmdBuff,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            NULL,
+            0,
+            NULL
+        );
     }
 }
 
 mc_Program* mc_program_create(mc_Device* device, mc_ProgramCode* code) {
     if (!device) return NULL;
     if (!code) return NULL;
+    if (!mc_device_open(device)) return NULL;
 
     mc_Program* program = malloc(sizeof *program);
     *program = (mc_Program){
@@ -248,6 +359,11 @@ mc_Program* mc_program_create(mc_Device* device, mc_ProgramCode* code) {
         .dim = {1, 1, 1},
         .buffCount = -1,
         .buffs = NULL,
+        .bindingCount = code->bindingCount,
+        .bindings = NULL,
+        .pushSize = code->pushConstantSize,
+        .pushData = NULL,
+        .pushChanged = false,
         .shaderModule = NULL,
         .descSetLayout = NULL,
         .pipelineLayout = NULL,
@@ -256,8 +372,36 @@ mc_Program* mc_program_create(mc_Device* device, mc_ProgramCode* code) {
         .descSet = NULL,
         .cmdPool = NULL,
         .cmdBuff = NULL,
+        .queueIdx = 0,
+        .fence = NULL,
+        .codeLock = mc_mutex_create(),
+        .pending = NULL,
     };
 
+    program->bindings = malloc(sizeof *program->bindings * code->bindingCount);
+    memcpy(
+        program->bindings,
+        code->bindings,
+        sizeof *program->bindings * code->bindingCount
+    );
+    program->pushData = calloc(1, program->pushSize ? program->pushSize : 1);
+
+    for (uint32_t i = 0; i < program->bindingCount; i++) {
+        mc_Binding* binding = &program->bindings[i];
+        if (binding->set != 0 || binding->count != 1
+            || binding->type == MC_BINDING_TYPE_OTHER) {
+            ERROR(
+                program,
+                "unsupported binding %d (set %d), only single storage and "
+                "uniform buffers in set 0 are supported",
+                binding->binding,
+                binding->set
+            );
+            mc_program_destroy(program);
+            return NULL;
+        }
+    }
+
     VkShaderModuleCreateInfo moduleInfo = {0};
     moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     moduleInfo.codeSize = code->size;
@@ -274,6 +418,20 @@ mc_Program* mc_program_create(mc_Device* device, mc_ProgramCode* code) {
         return NULL;
     }
 
+    if (!mc_program_create_pipeline(program)) {
+        mc_program_destroy(program);
+        return NULL;
+    }
+
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device->dev, &fenceInfo, NULL, &program->fence)) {
+        ERROR(program, "failed to create fence");
+        mc_program_destroy(program);
+        return NULL;
+    }
+
     return program;
 }
 
@@ -281,93 +439,257 @@ void mc_program_destroy(mc_Program* program) {
     if (!program) return;
     DEBUG(program, "destroying program");
 
+    VkDevice dev = program->device->dev;
+
     mc_program_clear(program);
+    if (program->fence) vkDestroyFence(dev, program->fence, NULL);
+    if (program->pipeline) vkDestroyPipeline(dev, program->pipeline, NULL);
+    if (program->pipelineLayout)
+        vkDestroyPipelineLayout(dev, program->pipelineLayout, NULL);
+    if (program->descSetLayout)
+        vkDestroyDescriptorSetLayout(dev, program->descSetLayout, NULL);
+    if (program->buffs) free(program->buffs);
+    if (program->bindings) free(program->bindings);
+    if (program->pushData) free(program->pushData);
     if (program->shaderModule)
-        vkDestroyShaderModule(
-            program->device->dev,
-            program->shaderModule,
-            NULL
-        );
+        vkDestroyShaderModule(dev, program->shaderModule, NULL);
+    if (program->pending) mc_program_destroy(program->pending);
+    mc_mutex_destroy(program->codeLock);
     free(program);
 }
 
-double mc_program_run__(
+bool mc_program_set_code(mc_Program* program, mc_ProgramCode* code) {
+    if (!program) return false;
+    DEBUG(program, "setting new program code");
+
+    // build everything that depends on the code now, so that the swap in the
+    // next run is cheap
+    mc_Program* pending = mc_program_create(program->device, code);
+    if (!pending) return false;
+
+    mc_mutex_lock(program->codeLock);
+    mc_Program* old = program->pending;
+    program->pending = pending;
+    mc_mutex_unlock(program->codeLock);
+
+    // replaced before it was ever used
+    if (old) mc_program_destroy(old);
+    return true;
+}
+
+// swap two fields of up to 8 bytes
+static void mc_swap(void* a, void* b, size_t size) {
+    char tmp[sizeof(uint64_t)];
+    memcpy(tmp, a, size);
+    memcpy(a, b, size);
+    memcpy(b, tmp, size);
+}
+
+// exchange everything that depends on the code with `pending`, which then
+// holds (and frees) the old code
+static void mc_program_swap_code(mc_Program* program, mc_Program* pending) {
+    DEBUG(program, "swapping in new program code");
+
+#define MC_SWAP(field)                                                         \
+    mc_swap(&program->field, &pending->field, sizeof program->field)
+
+    MC_SWAP(entryPoint);
+    MC_SWAP(bindingCount);
+    MC_SWAP(bindings);
+    MC_SWAP(pushSize);
+    MC_SWAP(pushData);
+    MC_SWAP(shaderModule);
+    MC_SWAP(descSetLayout);
+    MC_SWAP(pipelineLayout);
+    MC_SWAP(pipeline);
+
+#undef MC_SWAP
+
+    // keep the push constants that still fit
+    uint32_t size = program->pushSize < pending->pushSize ? program->pushSize
+                                                           : pending->pushSize;
+    memcpy(program->pushData, pending->pushData, size);
+
+    mc_program_destroy(pending);
+}
+
+bool mc_program_set_queue(mc_Program* program, uint32_t queue) {
+    if (!program) return false;
+
+    if (queue >= program->device->queueCount) {
+        ERROR(
+            program,
+            "queue %d does not exist, the device has %d queue(s)",
+            queue,
+            program->device->queueCount
+        );
+        return false;
+    }
+
+    program->queueIdx = queue;
+    return true;
+}
+
+uint32_t mc_program_set_push_constants(
+    mc_Program* program,
+    uint32_t size,
+    const void* data
+) {
+    if (!program) return 0;
+    DEBUG(program, "setting %d byte(s) of push constants", size);
+
+    if (size > program->pushSize) {
+        ERROR(
+            program,
+            "size > push constant size (%d bytes)",
+            program->pushSize
+        );
+        return 0;
+    }
+
+    if (memcmp(program->pushData, data, size) == 0) return size;
+
+    // the new values are recorded on the next run
+    memcpy(program->pushData, data, size);
+    program->pushChanged = true;
+    return size;
+}
+
+bool mc_program_configure(
     mc_Program* program,
     uint32_t dimX,
     uint32_t dimY,
     uint32_t dimZ,
-    ...
+    int32_t buffCount,
+    mc_Buffer** buffs
 ) {
-    if (!program) return -1.0;
-    DEBUG(program, "running %dx%dx%d program", dimX, dimY, dimZ);
-
-    if (dimX * dimY * dimZ == 0) {
-        ERROR(program, "at least one dimension is 0");
-        return -1.0;
+    bool buffsChanged = false;
+    bool dimChanged = false;
+
+    mc_mutex_lock(program->codeLock);
+    mc_Program* pending = program->pending;
+    program->pending = NULL;
+    mc_mutex_unlock(program->codeLock);
+
+    // the descriptors were allocated with the old layout
+    if (pending) {
+        mc_program_swap_code(program, pending);
+        buffsChanged = true;
     }
 
-    bool configChanged = false;
-
     // check if the dimensions have been changed
     if (dimX != program->dim[0] || dimY != program->dim[1]
         || dimZ != program->dim[2]) {
         program->dim[0] = dimX;
         program->dim[1] = dimY;
         program->dim[2] = dimZ;
-        configChanged = true;
+        dimChanged = true;
     }
 
     // check if the buffers have been changed
-    int32_t buffCount = 0;
-    va_list args;
-    va_start(args, dimZ);
-    while (va_arg(args, mc_Buffer*)) buffCount++;
-    va_end(args);
-
-    if (buffCount != program->buffCount) configChanged = true;
-
     if (buffCount != program->buffCount) {
         program->buffCount = buffCount;
         program->buffs
             = realloc(program->buffs, sizeof *program->buffs * buffCount);
         memset(program->buffs, 0, sizeof *program->buffs * buffCount);
+        buffsChanged = true;
     }
 
-    va_start(args, dimZ);
     for (int32_t i = 0; i < buffCount; i++) {
-        mc_Buffer* buff = va_arg(args, mc_Buffer*);
-        if (buff != program->buffs[i]) {
-            program->buffs[i] = buff;
-            configChanged = true;
+        if (buffs[i] != program->buffs[i]) {
+            program->buffs[i] = buffs[i];
+            buffsChanged = true;
         }
     }
-    va_end(args);
 
-    if (configChanged) mc_program_setup(program);
+    // new buffers need new descriptors, new dimensions or push constants only
+    // need the command buffer to be recorded again
+    bool ok = true;
+    if (buffsChanged)
+        ok = mc_program_setup(program);
+    else if (dimChanged || program->pushChanged)
+        ok = mc_program_record(program);
+
+    if (!ok) {
+        // force a full setup on the next call
+        program->buffCount = -1;
+        return false;
+    }
 
-    VkQueue queue;
-    vkGetDeviceQueue(
-        program->device->dev,
-        program->device->queueFamilyIdx,
-        0,
-        &queue
-    );
+    program->pushChanged = false;
+    return true;
+}
+
+double mc_program_dispatch(
+    mc_Program* program,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    int32_t buffCount,
+    mc_Buffer** buffs
+) {
+    if (!program) return -1.0;
+
+    if (!mc_program_configure(program, dimX, dimY, dimZ, buffCount, buffs))
+        return -1.0;
 
     VkSubmitInfo submitInfo = {0};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &program->cmdBuff;
 
-    if (vkQueueSubmit(queue, 1, &submitInfo, 0)) {
+    VkDevice dev = program->device->dev;
+    vkResetFences(dev, 1, &program->fence);
+
+    // wait on the fence, not the queue, other threads may share the queue
+    VkQueue queue = mc_device_lock_queue(program->device, program->queueIdx);
+    VkResult res = vkQueueSubmit(queue, 1, &submitInfo, program->fence);
+    mc_device_unlock_queue(program->device, program->queueIdx);
+
+    if (res) {
         ERROR(program, "failed to submit queue");
         return -1.0;
     }
 
     double startTime = mc_get_time();
-    if (vkQueueWaitIdle(queue)) {
-        ERROR(program, "failed to wait for queue completion");
+    if (vkWaitForFences(dev, 1, &program->fence, VK_TRUE, UINT64_MAX)) {
+        ERROR(program, "failed to wait for program completion");
         return -1.0;
     }
 
     return mc_get_time() - startTime;
-}
\ No newline at end of file
+}
+
+double mc_program_run__(
+    mc_Program* program,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    ...
+) {
+    if (!program) return -1.0;
+    DEBUG(program, "running %dx%dx%d program", dimX, dimY, dimZ);
+
+    if (dimX * dimY * dimZ == 0) {
+        ERROR(program, "at least one dimension is 0");
+        return -1.0;
+    }
+
+    // collect the buffers
+    int32_t buffCount = 0;
+    va_list args;
+    va_start(args, dimZ);
+    while (va_arg(args, mc_Buffer*)) buffCount++;
+    va_end(args);
+
+    mc_Buffer** buffs = malloc(sizeof *buffs * buffCount);
+    va_start(args, dimZ);
+    for (int32_t i = 0; i < buffCount; i++)
+        buffs[i] = va_arg(args, mc_Buffer*);
+    va_end(args);
+
+    double time
+        = mc_program_dispatch(program, dimX, dimY, dimZ, buffCount, buffs);
+    free(buffs);
+    return time;
+}
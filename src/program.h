@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 
 #include "microcompute.h"
+#include "misc.h"
 
 struct mc_Program {
     mc_Instance* _instance;
@@ -12,6 +13,11 @@ struct mc_Program {
     uint32_t dim[3];
     int32_t buffCount;
     mc_Buffer** buffs;
+    uint32_t bindingCount;
+    mc_Binding* bindings;
+    uint32_t pushSize;
+    char* pushData;
+    bool pushChanged;
     VkShaderModule shaderModule;
     VkDescriptorSetLayout descSetLayout;
     VkPipelineLayout pipelineLayout;
@@ -20,6 +26,48 @@ struct mc_Program {
     VkDescriptorSet descSet;
     VkCommandPool cmdPool;
     VkCommandBuffer cmdBuff;
+    uint32_t queueIdx;
+    VkFence fence; // signaled when a run is done
+    mc_Mutex* codeLock;
+    mc_Program* pending; // new code set by `mc_program_set_code()`
 };
 
+uint32_t mc_program_get_pool_sizes(
+    mc_Program* program,
+    uint32_t setCount,
+    VkDescriptorPoolSize* sizes
+);
+
+void mc_program_write_descriptors(
+    mc_Program* program,
+    VkDescriptorSet descSet,
+    mc_Buffer** buffs
+);
+
+void mc_program_record_dispatch(
+    mc_Program* program,
+    VkCommandBuffer cmdBuff,
+    VkDescriptorSet descSet
+);
+
+bool mc_program_configure(
+    mc_Program* program,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    int32_t buffCount,
+    mc_Buffer** buffs
+);
+
+// configure, submit and wait, the time is the one returned by
+// `mc_program_run()`
+double mc_program_dispatch(
+    mc_Program* program,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    int32_t buffCount,
+    mc_Buffer** buffs
+);
+
 #endif // MC_PROGRAM_H
\ No newline at end of file
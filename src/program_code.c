@@ -1,45 +1,233 @@
-#include <shaderc/shaderc.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef MC_WITH_SHADERC
+#include <shaderc/shaderc.h>
+
+#include "include_resolver.h"
+#endif
+
+#include "instance.h"
 #include "log.h"
+#include "misc.h"
 #include "program_code.h"
+#include "reflect.h"
+#include "spirv_cache.h"
 
-mc_ProgramCode* mc_program_code_create_from_spirv(
+// wrap SPIR-V code, taking ownership of `code` (or of `mapping`, which `code`
+// points into)
+static mc_ProgramCode* mc_program_code_wrap_spirv(
     mc_Instance* instance,
     size_t size,
-    const char* code
+    char* code,
+    mc_MappedFile* mapping
 ) {
-    if (!instance) return NULL;
-
     mc_ProgramCode* programCode = malloc(sizeof *programCode);
     *programCode = (mc_ProgramCode){
         ._instance = instance,
+        .entry = NULL,
         .size = size,
-        .code = NULL,
+        .code = code,
+        .mapping = mapping,
+        .depCount = 0,
+        .deps = NULL,
+        .depHashes = NULL,
+        .bindingCount = 0,
+        .bindings = NULL,
+        .localSize = {1, 1, 1},
+        .pushConstantSize = 0,
+        .specConstCount = 0,
+        .specConstIds = NULL,
     };
 
-    DEBUG(
-        programCode,
-        "creating program from SPIR-V code, size: %d",
-        programCode->size
-    );
-
-    memcpy(programCode->code, code, programCode->size);
+    // also picks the first compute entry point, SPIR-V has no default one
+    if (!mc_program_code_reflect(programCode)) {
+        mc_program_code_destroy(programCode);
+        return NULL;
+    }
 
     return programCode;
 }
 
-mc_ProgramCode* mc_program_code_create_from_glsl__(
+mc_ProgramCode* mc_program_code_create_from_spirv(
     mc_Instance* instance,
+    size_t size,
+    const char* code
+) {
+    if (!instance) return NULL;
+    if (!code) return NULL;
+
+    DEBUG(instance, "creating program from SPIR-V code, size: %zu", size);
+
+    char* copy = malloc(size ? size : 1);
+    memcpy(copy, code, size);
+    return mc_program_code_wrap_spirv(instance, size, copy, NULL);
+}
+
+mc_ProgramCode* mc_program_code_create_from_spirv_file(
+    mc_Instance* instance,
+    const char* path
+) {
+    if (!instance) return NULL;
+    if (!path) return NULL;
+
+    DEBUG(instance, "creating program from SPIR-V file %s", path);
+
+    // the pages are only read in by the driver when the module is created
+    const void* data;
+    size_t size;
+    mc_MappedFile* mapping = mc_map_file(path, &data, &size);
+    if (mapping)
+        return mc_program_code_wrap_spirv(instance, size, (char*)data, mapping);
+
+    // some file systems can't be mapped, read the file instead. Only regular
+    // files are supported, pipes fail here too
+    char* code = mc_read_file(path, &size);
+    if (!code) {
+        ERROR(instance, "failed to read %s", path);
+        return NULL;
+    }
+    return mc_program_code_wrap_spirv(instance, size, code, NULL);
+}
+
+#ifdef MC_WITH_SHADERC
+
+// bump when the way GLSL is handed to the compiler changes, cached SPIR-V
+// built the old way is then never reused
+#define MC_COMPILER_ABI 1
+
+// set by the build to a hash of the shaderc library
+#ifndef MC_SHADERC_BUILD_ID
+#define MC_SHADERC_BUILD_ID "unknown"
+#endif
+
+static mc_SpirvCacheKey mc_program_code_cache_key(
+    mc_Instance* instance,
+    mc_CompileOptions* settings,
     const char* name,
     const char* code,
     const char* entry,
-    ...
+    uint32_t defCount,
+    mc_CompileDefinition* defs
+) {
+    unsigned int spvVersion, spvRevision;
+    shaderc_get_spv_version(&spvVersion, &spvRevision);
+
+    uint64_t params[] = {
+        settings->vulkanVersion,
+        settings->spirvVersion,
+        settings->optimizationLevel,
+        settings->debugInfo,
+        shaderc_glsl_compute_shader,
+        MC_COMPILER_ABI,
+        spvVersion,
+        spvRevision,
+        defCount,
+        instance->includePathCount,
+    };
+
+    // identical code in another directory may include other files
+    size_t dirLen;
+    const char* dir = mc_include_resolver_dir(name, &dirLen);
+
+    mc_SpirvCacheKey key;
+    for (uint32_t i = 0; i < 2; i++) {
+        uint64_t hash = mc_hash(MC_HASH_SEED, &i, sizeof i);
+        hash = mc_hash(hash, params, sizeof params);
+        hash = mc_hash_str(hash, MC_SHADERC_BUILD_ID);
+        hash = mc_hash_str(hash, entry);
+        hash = mc_hash(hash, &dirLen, sizeof dirLen);
+        hash = mc_hash(hash, dir, dirLen);
+        for (uint32_t j = 0; j < instance->includePathCount; j++)
+            hash = mc_hash_str(hash, instance->includePaths[j]);
+        for (uint32_t j = 0; j < defCount; j++) {
+            hash = mc_hash_str(hash, defs[j].key);
+            hash = mc_hash_str(hash, defs[j].value);
+        }
+        key.hash[i] = mc_hash_str(hash, code);
+    }
+
+    return key;
+}
+
+// create the shared compiler and base options on first use, and return a copy
+// of the base options for a single compilation, with `settings` applied
+static shaderc_compile_options_t mc_program_code_get_compiler(
+    mc_Instance* instance,
+    mc_CompileOptions* settings,
+    shaderc_compiler_t* compiler
+) {
+    shaderc_compile_options_t options = NULL;
+    mc_mutex_lock(instance->compilerLock);
+
+    if (!instance->compiler) {
+        DEBUG(instance, "initializing shader compiler");
+
+        instance->compiler = shaderc_compiler_initialize();
+        if (!instance->compiler) {
+            ERROR(instance, "failed to initialize shader compiler");
+            goto end;
+        }
+
+        instance->compileOptions = shaderc_compile_options_initialize();
+        if (!instance->compileOptions) {
+            ERROR(instance, "failed to initialize shader compiler options");
+            shaderc_compiler_release(instance->compiler);
+            instance->compiler = NULL;
+            goto end;
+        }
+    }
+
+    options = shaderc_compile_options_clone(instance->compileOptions);
+    if (!options) {
+        ERROR(instance, "failed to clone shader compiler options");
+        goto end;
+    }
+    *compiler = instance->compiler;
+
+    static const shaderc_optimization_level levels[] = {
+        [MC_OPTIMIZATION_LEVEL_NONE] = shaderc_optimization_level_zero,
+        [MC_OPTIMIZATION_LEVEL_SIZE] = shaderc_optimization_level_size,
+        [MC_OPTIMIZATION_LEVEL_PERFORMANCE]
+        = shaderc_optimization_level_performance,
+    };
+
+    // MC_VULKAN_VERSION() and MC_SPIRV_VERSION() match the shaderc encodings
+    shaderc_compile_options_set_optimization_level(
+        options,
+        levels[settings->optimizationLevel]
+    );
+    shaderc_compile_options_set_target_env(
+        options,
+        shaderc_target_env_vulkan,
+        settings->vulkanVersion
+    );
+    if (settings->spirvVersion)
+        shaderc_compile_options_set_target_spirv(
+            options,
+            (shaderc_spirv_version)settings->spirvVersion
+        );
+    if (settings->debugInfo)
+        shaderc_compile_options_set_generate_debug_info(options);
+
+end:
+    mc_mutex_unlock(instance->compilerLock);
+    return options;
+}
+
+mc_ProgramCode* mc_program_code_compile(
+    mc_Instance* instance,
+    const char* name,
+    const char* code,
+    const char* entry,
+    uint32_t defCount,
+    mc_CompileDefinition* defs,
+    char** diagnostics
 ) {
     if (!instance) return NULL;
+    if (diagnostics) *diagnostics = NULL;
 
     mc_ProgramCode* programCode = malloc(sizeof *programCode);
     *programCode = (mc_ProgramCode){
@@ -47,6 +235,16 @@ mc_ProgramCode* mc_program_code_create_from_glsl__(
         .entry = NULL,
         .size = 0,
         .code = NULL,
+        .mapping = NULL,
+        .depCount = 0,
+        .deps = NULL,
+        .depHashes = NULL,
+        .bindingCount = 0,
+        .bindings = NULL,
+        .localSize = {1, 1, 1},
+        .pushConstantSize = 0,
+        .specConstCount = 0,
+        .specConstIds = NULL,
     };
 
     DEBUG(
@@ -68,47 +266,53 @@ mc_ProgramCode* mc_program_code_create_from_glsl__(
         return NULL;
     }
 
-    shaderc_compile_options_t options = shaderc_compile_options_initialize();
-    if (!options) {
-        ERROR(programCode, "failed to initialize shader compiler options");
+    programCode->entry = malloc(strlen(entry) + 1);
+    memcpy(programCode->entry, entry, strlen(entry) + 1);
+
+    // take a snapshot, the options may be changed by another thread
+    mc_CompileOptions settings = mc_instance_get_compile_options(instance);
+    mc_SpirvCacheKey key = mc_program_code_cache_key(
+        instance,
+        &settings,
+        name,
+        code,
+        entry,
+        defCount,
+        defs
+    );
+    if (mc_spirv_cache_load(instance, key, programCode)) {
+        if (mc_program_code_reflect(programCode)) return programCode;
         mc_program_code_destroy(programCode);
         return NULL;
     }
 
-    va_list args;
-    va_start(args, entry);
-    while (true) {
-        mc_CompileDefinition option = va_arg(args, mc_CompileDefinition);
-        if (!option.key || !option.value) break;
+    shaderc_compiler_t compiler;
+    shaderc_compile_options_t options
+        = mc_program_code_get_compiler(instance, &settings, &compiler);
+    if (!options) {
+        mc_program_code_destroy(programCode);
+        return NULL;
+    }
 
+    for (uint32_t i = 0; i < defCount; i++) {
         DEBUG(
             programCode,
             "- defining \"%s\": \"%s\"",
-            option.key,
-            option.value
+            defs[i].key,
+            defs[i].value
         );
 
         shaderc_compile_options_add_macro_definition(
             options,
-            option.key,
-            strlen(option.key),
-            option.value,
-            strlen(option.value)
+            defs[i].key,
+            strlen(defs[i].key),
+            defs[i].value,
+            strlen(defs[i].value)
         );
     }
-    va_end(args);
 
-    shaderc_compile_options_set_optimization_level(
-        options,
-        shaderc_optimization_level_performance
-    );
-
-    shaderc_compiler_t compiler = shaderc_compiler_initialize();
-    if (!compiler) {
-        ERROR(programCode, "failed to initialize shader compiler");
-        mc_program_code_destroy(programCode);
-        return NULL;
-    }
+    mc_IncludeResolver resolver;
+    mc_include_resolver_init(&resolver, instance, options);
 
     shaderc_compilation_result_t result = shaderc_compile_into_spv(
         compiler,
@@ -122,17 +326,19 @@ mc_ProgramCode* mc_program_code_create_from_glsl__(
 
     shaderc_compile_options_release(options);
 
+    const char* message = shaderc_result_get_error_message(result);
+    if (diagnostics && message && strlen(message) > 0) {
+        *diagnostics = malloc(strlen(message) + 1);
+        memcpy(*diagnostics, message, strlen(message) + 1);
+    }
+
     if (shaderc_result_get_num_errors(result)
         || shaderc_result_get_num_warnings(result)) {
         ERROR(programCode, "failed to compile shader code:");
-        ERROR(
-            programCode,
-            "errors:\n%s",
-            shaderc_result_get_error_message(result)
-        );
+        ERROR(programCode, "errors:\n%s", message);
         ERROR(programCode, "code:\n```\n%s\n```", code);
         shaderc_result_release(result);
-        shaderc_compiler_release(compiler);
+        mc_include_resolver_clear(&resolver);
         mc_program_code_destroy(programCode);
         return NULL;
     }
@@ -146,18 +352,208 @@ mc_ProgramCode* mc_program_code_create_from_glsl__(
     );
 
     shaderc_result_release(result);
-    shaderc_compiler_release(compiler);
 
-    programCode->entry = malloc(strlen(entry) + 1);
-    memcpy(programCode->entry, entry, strlen(entry) + 1);
+    // the program code takes over the list of included files
+    programCode->depCount = resolver.depCount;
+    programCode->deps = resolver.deps;
+    programCode->depHashes = resolver.depHashes;
+
+    if (!mc_program_code_reflect(programCode)) {
+        mc_program_code_destroy(programCode);
+        return NULL;
+    }
+
+    mc_spirv_cache_store(instance, key, programCode);
+
+    return programCode;
+}
+
+#else
+
+mc_ProgramCode* mc_program_code_compile(
+    mc_Instance* instance,
+    const char* name,
+    const char* code,
+    const char* entry,
+    uint32_t defCount,
+    mc_CompileDefinition* defs,
+    char** diagnostics
+) {
+    if (!instance) return NULL;
+    if (diagnostics) *diagnostics = NULL;
+    ERROR(instance, "cannot compile %s, built without MC_WITH_SHADERC", name);
+    return NULL;
+}
+
+#endif // MC_WITH_SHADERC
+
+mc_ProgramCode* mc_program_code_create_from_glsl__(
+    mc_Instance* instance,
+    const char* name,
+    const char* code,
+    const char* entry,
+    ...
+) {
+    if (!instance) return NULL;
+
+    uint32_t defCount = 0;
+    va_list args;
+    va_start(args, entry);
+    while (true) {
+        mc_CompileDefinition def = va_arg(args, mc_CompileDefinition);
+        if (!def.key || !def.value) break;
+        defCount++;
+    }
+    va_end(args);
+
+    mc_CompileDefinition* defs = malloc(sizeof *defs * (defCount + 1));
+    va_start(args, entry);
+    for (uint32_t i = 0; i < defCount; i++)
+        defs[i] = va_arg(args, mc_CompileDefinition);
+    va_end(args);
 
+    mc_ProgramCode* programCode = mc_program_code_compile(
+        instance,
+        name,
+        code,
+        entry,
+        defCount,
+        defs,
+        NULL
+    );
+
+    free(defs);
     return programCode;
 }
 
+typedef struct mc_CompileBatch {
+    mc_Instance* instance;
+    mc_Mutex* lock;
+    uint32_t jobCount;
+    uint32_t nextJob;
+    mc_CompileJob* jobs;
+} mc_CompileBatch;
+
+static void mc_program_code_batch_worker(void* arg) {
+    mc_CompileBatch* batch = arg;
+
+    while (true) {
+        mc_mutex_lock(batch->lock);
+        uint32_t idx = batch->nextJob++;
+        mc_mutex_unlock(batch->lock);
+        if (idx >= batch->jobCount) return;
+
+        mc_CompileJob* job = &batch->jobs[idx];
+
+        // stop at the first incomplete entry, like the variadic definitions
+        uint32_t defCount = 0;
+        while (job->defs && job->defs[defCount].key
+               && job->defs[defCount].value)
+            defCount++;
+
+        job->result = mc_program_code_compile(
+            batch->instance,
+            job->name,
+            job->code,
+            job->entry,
+            defCount,
+            job->defs,
+            &job->diagnostics
+        );
+    }
+}
+
+uint32_t mc_program_code_create_batch(
+    mc_Instance* instance,
+    uint32_t jobCount,
+    mc_CompileJob* jobs
+) {
+    if (!instance || !jobs) return 0;
+
+    uint32_t threadCount = mc_get_cpu_count();
+    if (threadCount > jobCount) threadCount = jobCount;
+    if (threadCount == 0) return 0;
+
+    DEBUG(
+        instance,
+        "compiling %d program(s) on %d thread(s)",
+        jobCount,
+        threadCount
+    );
+
+    mc_CompileBatch batch = {
+        .instance = instance,
+        .lock = mc_mutex_create(),
+        .jobCount = jobCount,
+        .nextJob = 0,
+        .jobs = jobs,
+    };
+
+    for (uint32_t i = 0; i < jobCount; i++) {
+        jobs[i].result = NULL;
+        jobs[i].diagnostics = NULL;
+    }
+
+    // the calling thread is one of the workers; if a thread can't be started,
+    // its share is picked up by the others
+    mc_Thread** threads = malloc(sizeof *threads * threadCount);
+    for (uint32_t i = 1; i < threadCount; i++)
+        threads[i] = mc_thread_create(mc_program_code_batch_worker, &batch);
+
+    mc_program_code_batch_worker(&batch);
+
+    for (uint32_t i = 1; i < threadCount; i++) mc_thread_join(threads[i]);
+    free(threads);
+    mc_mutex_destroy(batch.lock);
+
+    uint32_t compiled = 0;
+    for (uint32_t i = 0; i < jobCount; i++) compiled += jobs[i].result != NULL;
+    return compiled;
+}
+
 void mc_program_code_destroy(mc_ProgramCode* programCode) {
     if (!programCode) return;
     DEBUG(programCode, "destroying program code");
-    if (programCode->code) free(programCode->code);
+    if (programCode->mapping) mc_unmap_file(programCode->mapping);
+    else if (programCode->code) free(programCode->code);
+    for (uint32_t i = 0; i < programCode->depCount; i++)
+        free(programCode->deps[i]);
+    if (programCode->deps) free(programCode->deps);
+    if (programCode->depHashes) free(programCode->depHashes);
+    if (programCode->bindings) free(programCode->bindings);
+    if (programCode->specConstIds) free(programCode->specConstIds);
     if (programCode->entry) free(programCode->entry);
     free(programCode);
-}
\ No newline at end of file
+}
+
+uint32_t mc_program_code_get_dependency_count(mc_ProgramCode* programCode) {
+    return programCode ? programCode->depCount : 0;
+}
+
+char** mc_program_code_get_dependencies(mc_ProgramCode* programCode) {
+    return programCode ? programCode->deps : NULL;
+}
+
+uint32_t mc_program_code_get_binding_count(mc_ProgramCode* programCode) {
+    return programCode ? programCode->bindingCount : 0;
+}
+
+mc_Binding* mc_program_code_get_bindings(mc_ProgramCode* programCode) {
+    return programCode ? programCode->bindings : NULL;
+}
+
+uint32_t* mc_program_code_get_local_size(mc_ProgramCode* programCode) {
+    return programCode ? programCode->localSize : NULL;
+}
+
+uint32_t mc_program_code_get_push_constant_size(mc_ProgramCode* programCode) {
+    return programCode ? programCode->pushConstantSize : 0;
+}
+
+uint32_t mc_program_code_get_spec_constant_count(mc_ProgramCode* programCode) {
+    return programCode ? programCode->specConstCount : 0;
+}
+
+uint32_t* mc_program_code_get_spec_constant_ids(mc_ProgramCode* programCode) {
+    return programCode ? programCode->specConstIds : NULL;
+}
@@ -2,12 +2,33 @@
 #define PROGRAM_CODE_H
 
 #include "microcompute.h"
+#include "misc.h"
 
 typedef struct mc_ProgramCode {
     mc_Instance* _instance;
     char* entry;
     size_t size;
     char* code;
+    mc_MappedFile* mapping; // `code` points into it if not `NULL`
+    uint32_t depCount;
+    char** deps;
+    uint64_t* depHashes;
+    uint32_t bindingCount;
+    mc_Binding* bindings;
+    uint32_t localSize[3];
+    uint32_t pushConstantSize;
+    uint32_t specConstCount;
+    uint32_t* specConstIds;
 } mc_ProgramCode;
 
+mc_ProgramCode* mc_program_code_compile(
+    mc_Instance* instance,
+    const char* name,
+    const char* code,
+    const char* entry,
+    uint32_t defCount,
+    mc_CompileDefinition* defs,
+    char** diagnostics
+);
+
 #endif // PROGRAM_CODE_H
@@ -0,0 +1,307 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "misc.h"
+#include "program.h"
+#include "program_code.h"
+#include "program_family.h"
+
+#define MC_PROGRAM_FAMILY_MIN_CAPACITY 16
+
+static int mc_compare_definitions(const void* a, const void* b) {
+    const mc_CompileDefinition* x = a;
+    const mc_CompileDefinition* y = b;
+    int res = strcmp(x->key, y->key);
+    return res ? res : strcmp(x->value, y->value);
+}
+
+// collect the `{NULL, NULL}` terminated definitions, in a canonical order so
+// that the same definitions passed in a different order map to one variant
+static uint32_t mc_collect_definitions(
+    va_list args,
+    mc_CompileDefinition** defs
+) {
+    va_list count;
+    va_copy(count, args);
+    uint32_t defCount = 0;
+    while (true) {
+        mc_CompileDefinition def = va_arg(count, mc_CompileDefinition);
+        if (!def.key || !def.value) break;
+        defCount++;
+    }
+    va_end(count);
+
+    *defs = malloc(sizeof **defs * (defCount + 1));
+    for (uint32_t i = 0; i < defCount; i++)
+        (*defs)[i] = va_arg(args, mc_CompileDefinition);
+
+    qsort(*defs, defCount, sizeof **defs, mc_compare_definitions);
+    return defCount;
+}
+
+static uint64_t mc_hash_definitions(
+    uint32_t defCount,
+    mc_CompileDefinition* defs
+) {
+    uint64_t hash = mc_hash(MC_HASH_SEED, &defCount, sizeof defCount);
+    for (uint32_t i = 0; i < defCount; i++) {
+        hash = mc_hash_str(hash, defs[i].key);
+        hash = mc_hash_str(hash, defs[i].value);
+    }
+    return hash;
+}
+
+static bool mc_variant_matches(
+    mc_ProgramVariant* variant,
+    uint64_t hash,
+    uint32_t defCount,
+    mc_CompileDefinition* defs
+) {
+    if (variant->hash != hash || variant->defCount != defCount) return false;
+    for (uint32_t i = 0; i < defCount; i++)
+        if (mc_compare_definitions(&variant->defs[i], &defs[i])) return false;
+    return true;
+}
+
+static void mc_variant_destroy(mc_ProgramVariant* variant) {
+    for (uint32_t i = 0; i < variant->programCount; i++)
+        mc_program_destroy(variant->programs[i]);
+    if (variant->programs) free(variant->programs);
+    mc_program_code_destroy(variant->code);
+
+    for (uint32_t i = 0; i < variant->defCount; i++) {
+        free(variant->defs[i].key);
+        free(variant->defs[i].value);
+    }
+    free(variant->defs);
+    mc_mutex_destroy(variant->lock);
+    free(variant);
+}
+
+// insert a variant in a table with free slots (linear probing)
+static void mc_program_family_insert(
+    mc_ProgramVariant** variants,
+    uint32_t capacity,
+    mc_ProgramVariant* variant
+) {
+    uint32_t idx = variant->hash & (capacity - 1);
+    while (variants[idx]) idx = (idx + 1) & (capacity - 1);
+    variants[idx] = variant;
+}
+
+// find the variant for some definitions, or add it (not compiled yet)
+static mc_ProgramVariant* mc_program_family_find(
+    mc_ProgramFamily* family,
+    uint32_t defCount,
+    mc_CompileDefinition* defs
+) {
+    uint64_t hash = mc_hash_definitions(defCount, defs);
+    mc_mutex_lock(family->lock);
+
+    uint32_t idx = hash & (family->capacity - 1);
+    for (; family->variants[idx]; idx = (idx + 1) & (family->capacity - 1)) {
+        mc_ProgramVariant* variant = family->variants[idx];
+        if (mc_variant_matches(variant, hash, defCount, defs)) {
+            mc_mutex_unlock(family->lock);
+            return variant;
+        }
+    }
+
+    mc_ProgramVariant* variant = malloc(sizeof *variant);
+    *variant = (mc_ProgramVariant){
+        .hash = hash,
+        .defCount = defCount,
+        .defs = malloc(sizeof *variant->defs * (defCount + 1)),
+        .lock = mc_mutex_create(),
+        .compiled = false,
+        .code = NULL,
+        .programCount = 0,
+        .programs = NULL,
+    };
+
+    for (uint32_t i = 0; i < defCount; i++) {
+        variant->defs[i].key = mc_copy_str(defs[i].key);
+        variant->defs[i].value = mc_copy_str(defs[i].value);
+    }
+
+    // keep the table at most half full
+    if (2 * (family->variantCount + 1) > family->capacity) {
+        uint32_t capacity = 2 * family->capacity;
+        mc_ProgramVariant** variants = calloc(capacity, sizeof *variants);
+        for (uint32_t i = 0; i < family->capacity; i++)
+            if (family->variants[i])
+                mc_program_family_insert(
+                    variants,
+                    capacity,
+                    family->variants[i]
+                );
+        free(family->variants);
+        family->variants = variants;
+        family->capacity = capacity;
+    }
+
+    mc_program_family_insert(family->variants, family->capacity, variant);
+    family->variantCount++;
+
+    mc_mutex_unlock(family->lock);
+    return variant;
+}
+
+// compile a variant on first use, callers must hold the variant's lock
+static mc_ProgramCode* mc_variant_get_code(
+    mc_ProgramFamily* family,
+    mc_ProgramVariant* variant
+) {
+    if (variant->compiled) return variant->code;
+
+    DEBUG(
+        family,
+        "compiling variant %016llx of %s",
+        (unsigned long long)variant->hash,
+        family->name
+    );
+
+    // failures are remembered as well, the code would fail again
+    variant->code = mc_program_code_compile(
+        family->_instance,
+        family->name,
+        family->code,
+        family->entry,
+        variant->defCount,
+        variant->defs,
+        NULL
+    );
+    variant->compiled = true;
+    return variant->code;
+}
+
+mc_ProgramFamily* mc_program_family_create(
+    mc_Instance* instance,
+    const char* name,
+    const char* code,
+    const char* entry
+) {
+    if (!instance) return NULL;
+
+    mc_ProgramFamily* family = malloc(sizeof *family);
+    *family = (mc_ProgramFamily){
+        ._instance = instance,
+        .name = NULL,
+        .code = NULL,
+        .entry = NULL,
+        .lock = NULL,
+        .variantCount = 0,
+        .capacity = MC_PROGRAM_FAMILY_MIN_CAPACITY,
+        .variants = NULL,
+    };
+
+    DEBUG(family, "creating program family %s", name);
+
+    if (!name || !code || !entry) {
+        ERROR(family, "name, code and entry must not be NULL");
+        mc_program_family_destroy(family);
+        return NULL;
+    }
+
+    family->name = mc_copy_str(name);
+    family->code = mc_copy_str(code);
+    family->entry = mc_copy_str(entry);
+    family->lock = mc_mutex_create();
+    family->variants = calloc(family->capacity, sizeof *family->variants);
+
+    if (!family->lock) {
+        ERROR(family, "failed to create mutex");
+        mc_program_family_destroy(family);
+        return NULL;
+    }
+
+    return family;
+}
+
+void mc_program_family_destroy(mc_ProgramFamily* family) {
+    if (!family) return;
+    DEBUG(family, "destroying program family");
+
+    if (family->variants) {
+        for (uint32_t i = 0; i < family->capacity; i++)
+            if (family->variants[i]) mc_variant_destroy(family->variants[i]);
+        free(family->variants);
+    }
+
+    if (family->name) free(family->name);
+    if (family->code) free(family->code);
+    if (family->entry) free(family->entry);
+    if (family->lock) mc_mutex_destroy(family->lock);
+    free(family);
+}
+
+uint32_t mc_program_family_get_variant_count(mc_ProgramFamily* family) {
+    if (!family) return 0;
+    mc_mutex_lock(family->lock);
+    uint32_t variantCount = family->variantCount;
+    mc_mutex_unlock(family->lock);
+    return variantCount;
+}
+
+mc_ProgramCode* mc_program_family_get_code__(mc_ProgramFamily* family, ...) {
+    if (!family) return NULL;
+
+    mc_CompileDefinition* defs;
+    va_list args;
+    va_start(args, family);
+    uint32_t defCount = mc_collect_definitions(args, &defs);
+    va_end(args);
+
+    mc_ProgramVariant* variant
+        = mc_program_family_find(family, defCount, defs);
+    free(defs);
+
+    mc_mutex_lock(variant->lock);
+    mc_ProgramCode* code = mc_variant_get_code(family, variant);
+    mc_mutex_unlock(variant->lock);
+    return code;
+}
+
+mc_Program* mc_program_family_get_program__(
+    mc_ProgramFamily* family,
+    mc_Device* device,
+    ...
+) {
+    if (!family) return NULL;
+    if (!device) return NULL;
+
+    mc_CompileDefinition* defs;
+    va_list args;
+    va_start(args, device);
+    uint32_t defCount = mc_collect_definitions(args, &defs);
+    va_end(args);
+
+    mc_ProgramVariant* variant
+        = mc_program_family_find(family, defCount, defs);
+    free(defs);
+
+    mc_mutex_lock(variant->lock);
+
+    mc_Program* program = NULL;
+    for (uint32_t i = 0; i < variant->programCount && !program; i++)
+        if (variant->programs[i]->device == device)
+            program = variant->programs[i];
+
+    mc_ProgramCode* code = mc_variant_get_code(family, variant);
+    if (!program && code) {
+        program = mc_program_create(device, code);
+        if (program) {
+            uint32_t idx = variant->programCount++;
+            variant->programs = realloc(
+                variant->programs,
+                sizeof *variant->programs * variant->programCount
+            );
+            variant->programs[idx] = program;
+        }
+    }
+
+    mc_mutex_unlock(variant->lock);
+    return program;
+}
@@ -0,0 +1,30 @@
+#ifndef MC_PROGRAM_FAMILY_H
+#define MC_PROGRAM_FAMILY_H
+
+#include "microcompute.h"
+#include "misc.h"
+
+// one set of definitions of a family, compiled on first use
+typedef struct mc_ProgramVariant {
+    uint64_t hash;
+    uint32_t defCount;
+    mc_CompileDefinition* defs; // sorted by key, then value
+    mc_Mutex* lock;             // held while compiling / creating programs
+    bool compiled;              // `code` is `NULL` if the compilation failed
+    mc_ProgramCode* code;
+    uint32_t programCount;
+    mc_Program** programs; // one per device, created on first use
+} mc_ProgramVariant;
+
+struct mc_ProgramFamily {
+    mc_Instance* _instance;
+    char* name;
+    char* code;
+    char* entry;
+    mc_Mutex* lock; // guards the variant table, not the variants
+    uint32_t variantCount;
+    uint32_t capacity;
+    mc_ProgramVariant** variants; // open addressing, `capacity` slots
+};
+
+#endif // MC_PROGRAM_FAMILY_H
@@ -0,0 +1,487 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "program_code.h"
+#include "reflect.h"
+
+#define MC_SPIRV_MAGIC 0x07230203
+#define MC_SPIRV_MAX_ID_BOUND 0x400000
+#define MC_SPIRV_MAX_TYPE_DEPTH 32
+
+// the parts of the SPIR-V specification needed to find the interface of a
+// compute shader
+
+enum {
+    MC_OP_ENTRY_POINT = 15,
+    MC_OP_EXECUTION_MODE = 16,
+    MC_OP_TYPE_INT = 21,
+    MC_OP_TYPE_FLOAT = 22,
+    MC_OP_TYPE_VECTOR = 23,
+    MC_OP_TYPE_MATRIX = 24,
+    MC_OP_TYPE_IMAGE = 25,
+    MC_OP_TYPE_SAMPLER = 26,
+    MC_OP_TYPE_SAMPLED_IMAGE = 27,
+    MC_OP_TYPE_ARRAY = 28,
+    MC_OP_TYPE_RUNTIME_ARRAY = 29,
+    MC_OP_TYPE_STRUCT = 30,
+    MC_OP_TYPE_POINTER = 32,
+    MC_OP_TYPE_FORWARD_POINTER = 39,
+    MC_OP_CONSTANT = 43,
+    MC_OP_CONSTANT_COMPOSITE = 44,
+    MC_OP_SPEC_CONSTANT_TRUE = 48,
+    MC_OP_SPEC_CONSTANT_FALSE = 49,
+    MC_OP_SPEC_CONSTANT = 50,
+    MC_OP_SPEC_CONSTANT_COMPOSITE = 51,
+    MC_OP_VARIABLE = 59,
+    MC_OP_DECORATE = 71,
+    MC_OP_MEMBER_DECORATE = 72,
+};
+
+enum {
+    MC_DECORATION_SPEC_ID = 1,
+    MC_DECORATION_BUFFER_BLOCK = 3,
+    MC_DECORATION_ARRAY_STRIDE = 6,
+    MC_DECORATION_MATRIX_STRIDE = 7,
+    MC_DECORATION_BUILT_IN = 11,
+    MC_DECORATION_BINDING = 33,
+    MC_DECORATION_DESCRIPTOR_SET = 34,
+    MC_DECORATION_OFFSET = 35,
+};
+
+enum {
+    MC_STORAGE_CLASS_UNIFORM_CONSTANT = 0,
+    MC_STORAGE_CLASS_UNIFORM = 2,
+    MC_STORAGE_CLASS_PUSH_CONSTANT = 9,
+    MC_STORAGE_CLASS_STORAGE_BUFFER = 12,
+    MC_STORAGE_CLASS_PHYSICAL_STORAGE_BUFFER = 5349,
+};
+
+#define MC_EXECUTION_MODEL_GL_COMPUTE 5
+#define MC_EXECUTION_MODE_LOCAL_SIZE 17
+#define MC_EXECUTION_MODE_LOCAL_SIZE_ID 38
+#define MC_BUILT_IN_WORKGROUP_SIZE 25
+
+#define MC_ID_HAS_SET (1 << 0)
+#define MC_ID_HAS_BINDING (1 << 1)
+#define MC_ID_HAS_SPEC_ID (1 << 2)
+#define MC_ID_BUFFER_BLOCK (1 << 3)
+#define MC_ID_WORKGROUP_SIZE (1 << 4)
+
+typedef struct mc_SpirvId {
+    const uint32_t* inst; // the instruction defining the id, or `NULL`
+    uint32_t flags;
+    uint32_t set;
+    uint32_t binding;
+    uint32_t specId;
+    uint32_t arrayStride;
+} mc_SpirvId;
+
+typedef struct mc_Reflection {
+    const uint32_t* words;
+    uint32_t wordCount;
+    uint32_t idBound;
+    mc_SpirvId* ids;
+} mc_Reflection;
+
+// get operand `idx` of an instruction (the opcode is operand 0), or 0 if the
+// instruction is too short
+static uint32_t mc_operand(const uint32_t* inst, uint32_t idx) {
+    return inst && idx < (inst[0] >> 16) ? inst[idx] : 0;
+}
+
+static uint32_t mc_opcode(const uint32_t* inst) {
+    return inst ? inst[0] & 0xffff : 0;
+}
+
+static const uint32_t* mc_reflect_def(mc_Reflection* r, uint32_t id) {
+    return id < r->idBound ? r->ids[id].inst : NULL;
+}
+
+static bool mc_reflect_constant(mc_Reflection* r, uint32_t id, uint32_t* res) {
+    const uint32_t* inst = mc_reflect_def(r, id);
+    uint32_t op = mc_opcode(inst);
+    if (op != MC_OP_CONSTANT && op != MC_OP_SPEC_CONSTANT) return false;
+    *res = mc_operand(inst, 3);
+    return true;
+}
+
+// member decorations are rare and only needed for push constant blocks, so
+// they are looked up in the code instead of being indexed
+static uint32_t mc_reflect_member_decoration(
+    mc_Reflection* r,
+    uint32_t structId,
+    uint32_t member,
+    uint32_t decoration
+) {
+    for (uint32_t i = 5; i < r->wordCount; i += r->words[i] >> 16) {
+        const uint32_t* inst = &r->words[i];
+        if (mc_opcode(inst) == MC_OP_MEMBER_DECORATE
+            && mc_operand(inst, 1) == structId
+            && mc_operand(inst, 2) == member
+            && mc_operand(inst, 3) == decoration)
+            return mc_operand(inst, 4);
+    }
+
+    return 0;
+}
+
+// the size of a type in an explicitly laid out block
+static uint32_t mc_reflect_type_size(
+    mc_Reflection* r,
+    uint32_t id,
+    uint32_t matrixStride,
+    uint32_t depth
+) {
+    const uint32_t* inst = mc_reflect_def(r, id);
+    if (!inst || depth > MC_SPIRV_MAX_TYPE_DEPTH) return 0;
+
+    switch (mc_opcode(inst)) {
+        case MC_OP_TYPE_INT:
+        case MC_OP_TYPE_FLOAT: return mc_operand(inst, 2) / 8;
+        case MC_OP_TYPE_VECTOR: {
+            uint32_t elem = mc_operand(inst, 2);
+            return mc_operand(inst, 3)
+                 * mc_reflect_type_size(r, elem, 0, depth + 1);
+        }
+        case MC_OP_TYPE_MATRIX: {
+            uint32_t column = mc_operand(inst, 2);
+            if (!matrixStride)
+                matrixStride = mc_reflect_type_size(r, column, 0, depth + 1);
+            return mc_operand(inst, 3) * matrixStride;
+        }
+        case MC_OP_TYPE_ARRAY: {
+            uint32_t length = 0;
+            mc_reflect_constant(r, mc_operand(inst, 3), &length);
+            uint32_t stride = r->ids[id].arrayStride;
+            if (!stride)
+                stride = mc_reflect_type_size(
+                    r,
+                    mc_operand(inst, 2),
+                    matrixStride,
+                    depth + 1
+                );
+            return length * stride;
+        }
+        case MC_OP_TYPE_STRUCT: {
+            uint32_t size = 0;
+            for (uint32_t i = 2; i < inst[0] >> 16; i++) {
+                uint32_t offset = mc_reflect_member_decoration(
+                    r,
+                    id,
+                    i - 2,
+                    MC_DECORATION_OFFSET
+                );
+                uint32_t stride = mc_reflect_member_decoration(
+                    r,
+                    id,
+                    i - 2,
+                    MC_DECORATION_MATRIX_STRIDE
+                );
+                uint32_t type = inst[i];
+                uint32_t end
+                    = offset + mc_reflect_type_size(r, type, stride, depth + 1);
+                if (end > size) size = end;
+            }
+            return size;
+        }
+        // buffer references (GL_EXT_buffer_reference) are 64 bit addresses,
+        // the storage class is operand 2 of both instructions
+        case MC_OP_TYPE_POINTER:
+        case MC_OP_TYPE_FORWARD_POINTER:
+            if (mc_operand(inst, 2) == MC_STORAGE_CLASS_PHYSICAL_STORAGE_BUFFER)
+                return sizeof(uint64_t);
+            return 0;
+        default: return 0;
+    }
+}
+
+// first pass: remember where every id is defined, and its decorations
+static bool mc_reflect_index(mc_ProgramCode* programCode, mc_Reflection* r) {
+    for (uint32_t i = 5, len; i < r->wordCount; i += len) {
+        const uint32_t* inst = &r->words[i];
+        len = inst[0] >> 16;
+        if (len == 0 || len > r->wordCount - i) {
+            ERROR(programCode, "invalid SPIR-V instruction at word %d", i);
+            return false;
+        }
+
+        uint32_t id = 0;
+        switch (mc_opcode(inst)) {
+            case MC_OP_TYPE_INT:
+            case MC_OP_TYPE_FLOAT:
+            case MC_OP_TYPE_VECTOR:
+            case MC_OP_TYPE_MATRIX:
+            case MC_OP_TYPE_IMAGE:
+            case MC_OP_TYPE_SAMPLER:
+            case MC_OP_TYPE_SAMPLED_IMAGE:
+            case MC_OP_TYPE_ARRAY:
+            case MC_OP_TYPE_RUNTIME_ARRAY:
+            case MC_OP_TYPE_STRUCT:
+            case MC_OP_TYPE_POINTER: id = mc_operand(inst, 1); break;
+            case MC_OP_TYPE_FORWARD_POINTER:
+                // the OpTypePointer that follows replaces it
+                id = mc_operand(inst, 1);
+                break;
+            case MC_OP_CONSTANT:
+            case MC_OP_CONSTANT_COMPOSITE:
+            case MC_OP_SPEC_CONSTANT_TRUE:
+            case MC_OP_SPEC_CONSTANT_FALSE:
+            case MC_OP_SPEC_CONSTANT:
+            case MC_OP_SPEC_CONSTANT_COMPOSITE:
+            case MC_OP_VARIABLE: id = mc_operand(inst, 2); break;
+            case MC_OP_DECORATE: {
+                uint32_t target = mc_operand(inst, 1);
+                uint32_t value = mc_operand(inst, 3);
+                if (target >= r->idBound) break;
+
+                mc_SpirvId* def = &r->ids[target];
+                switch (mc_operand(inst, 2)) {
+                    case MC_DECORATION_DESCRIPTOR_SET:
+                        def->flags |= MC_ID_HAS_SET;
+                        def->set = value;
+                        break;
+                    case MC_DECORATION_BINDING:
+                        def->flags |= MC_ID_HAS_BINDING;
+                        def->binding = value;
+                        break;
+                    case MC_DECORATION_SPEC_ID:
+                        def->flags |= MC_ID_HAS_SPEC_ID;
+                        def->specId = value;
+                        break;
+                    case MC_DECORATION_BUFFER_BLOCK:
+                        def->flags |= MC_ID_BUFFER_BLOCK;
+                        break;
+                    case MC_DECORATION_ARRAY_STRIDE:
+                        def->arrayStride = value;
+                        break;
+                    case MC_DECORATION_BUILT_IN:
+                        if (value == MC_BUILT_IN_WORKGROUP_SIZE)
+                            def->flags |= MC_ID_WORKGROUP_SIZE;
+                        break;
+                }
+                break;
+            }
+        }
+
+        if (id && id < r->idBound) r->ids[id].inst = inst;
+    }
+
+    return true;
+}
+
+static const uint32_t* mc_reflect_entry_point(
+    mc_ProgramCode* programCode,
+    mc_Reflection* r
+) {
+    for (uint32_t i = 5; i < r->wordCount; i += r->words[i] >> 16) {
+        const uint32_t* inst = &r->words[i];
+        if (mc_opcode(inst) != MC_OP_ENTRY_POINT
+            || mc_operand(inst, 1) != MC_EXECUTION_MODEL_GL_COMPUTE)
+            continue;
+
+        // the name is a nul terminated string packed into the operands
+        const char* name = (const char*)&inst[3];
+        size_t maxLen = ((inst[0] >> 16) - 3) * sizeof *inst;
+        if ((inst[0] >> 16) <= 3 || strnlen(name, maxLen) == maxLen) continue;
+
+        if (!programCode->entry) {
+            programCode->entry = malloc(strlen(name) + 1);
+            memcpy(programCode->entry, name, strlen(name) + 1);
+        }
+
+        if (strcmp(name, programCode->entry) == 0) return inst;
+    }
+
+    return NULL;
+}
+
+static void mc_reflect_local_size(
+    mc_ProgramCode* programCode,
+    mc_Reflection* r,
+    uint32_t entryId
+) {
+    uint32_t* size = programCode->localSize;
+
+    for (uint32_t i = 5; i < r->wordCount; i += r->words[i] >> 16) {
+        const uint32_t* inst = &r->words[i];
+        if (mc_opcode(inst) != MC_OP_EXECUTION_MODE
+            || mc_operand(inst, 1) != entryId)
+            continue;
+
+        if (mc_operand(inst, 2) == MC_EXECUTION_MODE_LOCAL_SIZE) {
+            for (uint32_t j = 0; j < 3; j++) size[j] = mc_operand(inst, 3 + j);
+        } else if (mc_operand(inst, 2) == MC_EXECUTION_MODE_LOCAL_SIZE_ID) {
+            for (uint32_t j = 0; j < 3; j++)
+                mc_reflect_constant(r, mc_operand(inst, 3 + j), &size[j]);
+        }
+    }
+
+    // a WorkgroupSize built-in (used for specializable local sizes) overrides
+    // the execution mode, its default values are reported
+    for (uint32_t id = 0; id < r->idBound; id++) {
+        if (!(r->ids[id].flags & MC_ID_WORKGROUP_SIZE)) continue;
+        const uint32_t* inst = r->ids[id].inst;
+        for (uint32_t j = 0; j < 3; j++)
+            mc_reflect_constant(r, mc_operand(inst, 3 + j), &size[j]);
+    }
+}
+
+static void mc_reflect_variable(
+    mc_ProgramCode* programCode,
+    mc_Reflection* r,
+    uint32_t id
+) {
+    const uint32_t* var = r->ids[id].inst;
+    const uint32_t* pointer = mc_reflect_def(r, mc_operand(var, 1));
+    uint32_t storage = mc_operand(var, 3);
+    uint32_t type = mc_operand(pointer, 3);
+
+    if (storage == MC_STORAGE_CLASS_PUSH_CONSTANT) {
+        uint32_t size = mc_reflect_type_size(r, type, 0, 0);
+        if (size > programCode->pushConstantSize)
+            programCode->pushConstantSize = size;
+        return;
+    }
+
+    if (storage != MC_STORAGE_CLASS_UNIFORM
+        && storage != MC_STORAGE_CLASS_STORAGE_BUFFER
+        && storage != MC_STORAGE_CLASS_UNIFORM_CONSTANT)
+        return;
+    if (!(r->ids[id].flags & MC_ID_HAS_BINDING)) return;
+
+    mc_Binding binding = {
+        .set = r->ids[id].set,
+        .binding = r->ids[id].binding,
+        .type = MC_BINDING_TYPE_OTHER,
+        .count = 1,
+    };
+
+    // arrays of descriptors
+    const uint32_t* inst = mc_reflect_def(r, type);
+    if (mc_opcode(inst) == MC_OP_TYPE_ARRAY) {
+        mc_reflect_constant(r, mc_operand(inst, 3), &binding.count);
+        type = mc_operand(inst, 2);
+    } else if (mc_opcode(inst) == MC_OP_TYPE_RUNTIME_ARRAY) {
+        binding.count = 0;
+        type = mc_operand(inst, 2);
+    }
+
+    bool bufferBlock
+        = type < r->idBound && (r->ids[type].flags & MC_ID_BUFFER_BLOCK);
+
+    if (storage == MC_STORAGE_CLASS_STORAGE_BUFFER
+        || (storage == MC_STORAGE_CLASS_UNIFORM && bufferBlock))
+        binding.type = MC_BINDING_TYPE_STORAGE_BUFFER;
+    else if (storage == MC_STORAGE_CLASS_UNIFORM)
+        binding.type = MC_BINDING_TYPE_UNIFORM_BUFFER;
+
+    uint32_t idx = programCode->bindingCount++;
+    programCode->bindings = realloc(
+        programCode->bindings,
+        sizeof *programCode->bindings * programCode->bindingCount
+    );
+    programCode->bindings[idx] = binding;
+}
+
+static int mc_compare_bindings(const void* a, const void* b) {
+    const mc_Binding* x = a;
+    const mc_Binding* y = b;
+    if (x->set != y->set) return x->set < y->set ? -1 : 1;
+    if (x->binding != y->binding) return x->binding < y->binding ? -1 : 1;
+    return 0;
+}
+
+static int mc_compare_ids(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+bool mc_program_code_reflect(mc_ProgramCode* programCode) {
+    const uint32_t* words = (const uint32_t*)programCode->code;
+    uint32_t wordCount = programCode->size / sizeof *words;
+
+    if (!words || programCode->size % sizeof *words || wordCount < 5
+        || words[0] != MC_SPIRV_MAGIC
+        || words[3] > MC_SPIRV_MAX_ID_BOUND) {
+        ERROR(programCode, "invalid SPIR-V code");
+        return false;
+    }
+
+    mc_Reflection r = {
+        .words = words,
+        .wordCount = wordCount,
+        .idBound = words[3],
+        .ids = calloc(words[3], sizeof *r.ids),
+    };
+
+    if (!mc_reflect_index(programCode, &r)) {
+        free(r.ids);
+        return false;
+    }
+
+    const uint32_t* entry = mc_reflect_entry_point(programCode, &r);
+    if (!entry) {
+        ERROR(
+            programCode,
+            "no compute entry point named \"%s\"",
+            programCode->entry ? programCode->entry : "(any)"
+        );
+        free(r.ids);
+        return false;
+    }
+
+    // the default local size is 1x1x1
+    for (uint32_t i = 0; i < 3; i++) programCode->localSize[i] = 1;
+    mc_reflect_local_size(programCode, &r, mc_operand(entry, 2));
+
+    for (uint32_t id = 0; id < r.idBound; id++) {
+        uint32_t op = mc_opcode(r.ids[id].inst);
+
+        if (op == MC_OP_VARIABLE) mc_reflect_variable(programCode, &r, id);
+
+        // SpecId only applies to scalars, booleans have their own opcodes
+        bool constant = op == MC_OP_SPEC_CONSTANT
+                     || op == MC_OP_SPEC_CONSTANT_TRUE
+                     || op == MC_OP_SPEC_CONSTANT_FALSE;
+        if (constant && (r.ids[id].flags & MC_ID_HAS_SPEC_ID)) {
+            uint32_t idx = programCode->specConstCount++;
+            programCode->specConstIds = realloc(
+                programCode->specConstIds,
+                sizeof *programCode->specConstIds * programCode->specConstCount
+            );
+            programCode->specConstIds[idx] = r.ids[id].specId;
+        }
+    }
+
+    free(r.ids);
+
+    if (programCode->bindingCount)
+        qsort(
+            programCode->bindings,
+            programCode->bindingCount,
+            sizeof *programCode->bindings,
+            mc_compare_bindings
+        );
+    if (programCode->specConstCount)
+        qsort(
+            programCode->specConstIds,
+            programCode->specConstCount,
+            sizeof *programCode->specConstIds,
+            mc_compare_ids
+        );
+
+    DEBUG(
+        programCode,
+        "reflected %d binding(s), local size %dx%dx%d, %d byte(s) of push "
+        "constants, %d specialization constant(s)",
+        programCode->bindingCount,
+        programCode->localSize[0],
+        programCode->localSize[1],
+        programCode->localSize[2],
+        programCode->pushConstantSize,
+        programCode->specConstCount
+    );
+
+    return true;
+}
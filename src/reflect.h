@@ -0,0 +1,12 @@
+#ifndef MC_REFLECT_H
+#define MC_REFLECT_H
+
+#include "program_code.h"
+
+// fill in the interface of some program code (descriptor bindings, local
+// size, push constant size and specialization constants) from its SPIR-V. If
+// the program code has no entry point yet, the first compute entry point is
+// used.
+bool mc_program_code_reflect(mc_ProgramCode* programCode);
+
+#endif // MC_REFLECT_H
@@ -0,0 +1,330 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "misc.h"
+#include "program_code.h"
+#include "shader_watcher.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// how long to wait for more events after a change, editors often write a file
+// in several steps
+#define MC_SHADER_WATCHER_DEBOUNCE 0.05
+// interval between checks when there is no inotify
+#define MC_SHADER_WATCHER_POLL_INTERVAL 0.5
+
+static char* mc_get_dir(const char* path) {
+    const char* end = strrchr(path, '/');
+#ifdef _WIN32
+    const char* bsEnd = strrchr(path, '\\');
+    if (bsEnd > end) end = bsEnd;
+#endif
+    if (!end) return mc_copy_str(".");
+    if (end == path) return mc_copy_str("/");
+
+    char* dir = malloc(end - path + 1);
+    memcpy(dir, path, end - path);
+    dir[end - path] = '\0';
+    return dir;
+}
+
+// start watching the directory of a file, files are replaced rather than
+// written by some editors, so watching the file itself is not enough
+static void mc_shader_watcher_watch(
+    mc_ShaderWatcher* watcher,
+    const char* path
+) {
+#ifdef __linux__
+    if (watcher->notifyFd < 0) return;
+
+    // watching the same directory again is a no-op
+    char* dir = mc_get_dir(path);
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    if (inotify_add_watch(watcher->notifyFd, dir, mask) < 0)
+        WARN(watcher, "failed to watch %s, changes will be missed", dir);
+    free(dir);
+#else
+    (void)watcher;
+    (void)path;
+#endif
+}
+
+static void mc_watch_entry_clear_files(mc_WatchEntry* entry) {
+    for (uint32_t i = 0; i < entry->fileCount; i++) free(entry->files[i]);
+    if (entry->files) free(entry->files);
+    if (entry->hashes) free(entry->hashes);
+    entry->fileCount = 0;
+    entry->files = NULL;
+    entry->hashes = NULL;
+}
+
+// take the files (and their contents) a compilation depended on
+static void mc_watch_entry_set_files(
+    mc_ShaderWatcher* watcher,
+    mc_WatchEntry* entry,
+    mc_ProgramCode* code,
+    uint64_t hash
+) {
+    mc_watch_entry_clear_files(entry);
+
+    entry->fileCount = code->depCount + 1;
+    entry->files = malloc(sizeof *entry->files * entry->fileCount);
+    entry->hashes = malloc(sizeof *entry->hashes * entry->fileCount);
+
+    entry->files[0] = mc_copy_str(entry->path);
+    entry->hashes[0] = hash;
+    for (uint32_t i = 0; i < code->depCount; i++) {
+        entry->files[i + 1] = mc_copy_str(code->deps[i]);
+        entry->hashes[i + 1] = code->depHashes[i];
+    }
+
+    for (uint32_t i = 0; i < entry->fileCount; i++)
+        mc_shader_watcher_watch(watcher, entry->files[i]);
+}
+
+static mc_ProgramCode* mc_watch_entry_compile(
+    mc_ShaderWatcher* watcher,
+    mc_WatchEntry* entry,
+    uint64_t* hash
+) {
+    size_t size;
+    char* src = mc_read_file(entry->path, &size);
+    if (!src) {
+        ERROR(watcher, "failed to read %s", entry->path);
+        return NULL;
+    }
+
+    *hash = mc_hash(MC_HASH_SEED, src, size);
+    mc_ProgramCode* code = mc_program_code_compile(
+        watcher->_instance,
+        entry->path,
+        src,
+        entry->entry,
+        entry->defCount,
+        entry->defs,
+        NULL
+    );
+
+    free(src);
+    return code;
+}
+
+static bool mc_watch_entry_changed(mc_WatchEntry* entry) {
+    for (uint32_t i = 0; i < entry->fileCount; i++) {
+        // a file that can't be read is most likely being replaced, the event
+        // for the new file will follow
+        uint64_t hash;
+        if (!mc_hash_file(entry->files[i], &hash)) continue;
+        if (hash != entry->hashes[i]) return true;
+    }
+    return false;
+}
+
+static void mc_watch_entry_reload(
+    mc_ShaderWatcher* watcher,
+    mc_WatchEntry* entry
+) {
+    DEBUG(watcher, "%s changed, recompiling", entry->path);
+
+    uint64_t hash;
+    mc_ProgramCode* code = mc_watch_entry_compile(watcher, entry, &hash);
+
+    if (code && mc_program_set_code(entry->program, code)) {
+        mc_watch_entry_set_files(watcher, entry, code, hash);
+        INFO(watcher, "reloaded %s", entry->path);
+    } else {
+        // remember the broken contents, so they are not compiled again until
+        // the next change
+        for (uint32_t i = 0; i < entry->fileCount; i++)
+            mc_hash_file(entry->files[i], &entry->hashes[i]);
+        WARN(watcher, "failed to reload %s, keeping the old code", entry->path);
+    }
+
+    mc_program_code_destroy(code);
+}
+
+static void mc_watch_entry_destroy(mc_WatchEntry* entry) {
+    mc_watch_entry_clear_files(entry);
+    for (uint32_t i = 0; i < entry->defCount; i++) {
+        free(entry->defs[i].key);
+        free(entry->defs[i].value);
+    }
+    free(entry->defs);
+    free(entry->path);
+    free(entry->entry);
+    free(entry);
+}
+
+static bool mc_shader_watcher_should_stop(mc_ShaderWatcher* watcher) {
+    mc_mutex_lock(watcher->lock);
+    bool stop = watcher->stop;
+    mc_mutex_unlock(watcher->lock);
+    return stop;
+}
+
+// wait for something to (maybe) have changed, returns `false` on a timeout so
+// that the stop flag is checked regularly
+static bool mc_shader_watcher_wait(mc_ShaderWatcher* watcher) {
+#ifdef __linux__
+    if (watcher->notifyFd >= 0) {
+        struct pollfd pfd = {.fd = watcher->notifyFd, .events = POLLIN};
+        if (poll(&pfd, 1, 250) <= 0) return false;
+
+        // the events only say that something changed, the hashes say what
+        char buf[4096];
+        while (read(watcher->notifyFd, buf, sizeof buf) > 0)
+            ;
+        mc_sleep(MC_SHADER_WATCHER_DEBOUNCE);
+        while (read(watcher->notifyFd, buf, sizeof buf) > 0)
+            ;
+        return true;
+    }
+#endif
+    mc_sleep(MC_SHADER_WATCHER_POLL_INTERVAL);
+    return true;
+}
+
+static void mc_shader_watcher_main(void* arg) {
+    mc_ShaderWatcher* watcher = arg;
+
+    while (!mc_shader_watcher_should_stop(watcher)) {
+        if (!mc_shader_watcher_wait(watcher)) continue;
+
+        mc_mutex_lock(watcher->lock);
+        for (uint32_t i = 0; i < watcher->entryCount && !watcher->stop; i++)
+            if (mc_watch_entry_changed(watcher->entries[i]))
+                mc_watch_entry_reload(watcher, watcher->entries[i]);
+        mc_mutex_unlock(watcher->lock);
+    }
+}
+
+mc_ShaderWatcher* mc_shader_watcher_create(mc_Instance* instance) {
+    if (!instance) return NULL;
+
+    mc_ShaderWatcher* watcher = malloc(sizeof *watcher);
+    *watcher = (mc_ShaderWatcher){
+        ._instance = instance,
+        .lock = mc_mutex_create(),
+        .stop = false,
+        .thread = NULL,
+        .notifyFd = -1,
+        .entryCount = 0,
+        .entries = NULL,
+    };
+
+    DEBUG(watcher, "creating shader watcher");
+
+#ifdef __linux__
+    watcher->notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->notifyFd < 0)
+        WARN(watcher, "failed to initialize inotify, polling files instead");
+#endif
+
+    watcher->thread = mc_thread_create(mc_shader_watcher_main, watcher);
+    if (!watcher->thread) {
+        ERROR(watcher, "failed to create watcher thread");
+        mc_shader_watcher_destroy(watcher);
+        return NULL;
+    }
+
+    return watcher;
+}
+
+void mc_shader_watcher_destroy(mc_ShaderWatcher* watcher) {
+    if (!watcher) return;
+    DEBUG(watcher, "destroying shader watcher");
+
+    mc_mutex_lock(watcher->lock);
+    watcher->stop = true;
+    mc_mutex_unlock(watcher->lock);
+    mc_thread_join(watcher->thread);
+
+#ifdef __linux__
+    if (watcher->notifyFd >= 0) close(watcher->notifyFd);
+#endif
+
+    for (uint32_t i = 0; i < watcher->entryCount; i++)
+        mc_watch_entry_destroy(watcher->entries[i]);
+    if (watcher->entries) free(watcher->entries);
+    mc_mutex_destroy(watcher->lock);
+    free(watcher);
+}
+
+bool mc_shader_watcher_add__(
+    mc_ShaderWatcher* watcher,
+    mc_Program* program,
+    const char* path,
+    const char* entry,
+    ...
+) {
+    if (!watcher) return false;
+    if (!program) return false;
+
+    if (!path || !entry) {
+        ERROR(watcher, "path and entry must not be NULL");
+        return false;
+    }
+
+    DEBUG(watcher, "watching %s", path);
+
+    mc_WatchEntry* watchEntry = malloc(sizeof *watchEntry);
+    *watchEntry = (mc_WatchEntry){
+        .program = program,
+        .path = mc_copy_str(path),
+        .entry = mc_copy_str(entry),
+        .defCount = 0,
+        .defs = NULL,
+        .fileCount = 0,
+        .files = NULL,
+        .hashes = NULL,
+    };
+
+    va_list args;
+    va_start(args, entry);
+    while (true) {
+        mc_CompileDefinition def = va_arg(args, mc_CompileDefinition);
+        if (!def.key || !def.value) break;
+        uint32_t idx = watchEntry->defCount++;
+        watchEntry->defs = realloc(
+            watchEntry->defs,
+            sizeof *watchEntry->defs * (watchEntry->defCount + 1)
+        );
+        watchEntry->defs[idx].key = mc_copy_str(def.key);
+        watchEntry->defs[idx].value = mc_copy_str(def.value);
+    }
+    va_end(args);
+
+    if (!watchEntry->defs) watchEntry->defs = malloc(sizeof *watchEntry->defs);
+    watchEntry->defs[watchEntry->defCount]
+        = (mc_CompileDefinition){NULL, NULL};
+
+    // compile right away, so the program matches the file from the start and
+    // the includes are known
+    uint64_t hash;
+    mc_ProgramCode* code = mc_watch_entry_compile(watcher, watchEntry, &hash);
+    if (!code || !mc_program_set_code(program, code)) {
+        ERROR(watcher, "failed to compile %s, not watching it", path);
+        mc_program_code_destroy(code);
+        mc_watch_entry_destroy(watchEntry);
+        return false;
+    }
+
+    mc_mutex_lock(watcher->lock);
+    mc_watch_entry_set_files(watcher, watchEntry, code, hash);
+    uint32_t idx = watcher->entryCount++;
+    watcher->entries = realloc(
+        watcher->entries,
+        sizeof *watcher->entries * watcher->entryCount
+    );
+    watcher->entries[idx] = watchEntry;
+    mc_mutex_unlock(watcher->lock);
+
+    mc_program_code_destroy(code);
+    return true;
+}
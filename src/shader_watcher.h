@@ -0,0 +1,29 @@
+#ifndef MC_SHADER_WATCHER_H
+#define MC_SHADER_WATCHER_H
+
+#include "microcompute.h"
+#include "misc.h"
+
+// a program kept in sync with a GLSL file
+typedef struct mc_WatchEntry {
+    mc_Program* program;
+    char* path;
+    char* entry;
+    uint32_t defCount;
+    mc_CompileDefinition* defs; // `{NULL, NULL}` ended
+    uint32_t fileCount;
+    char** files;     // `path` followed by the included files
+    uint64_t* hashes; // contents of `files` as of the last compilation
+} mc_WatchEntry;
+
+struct mc_ShaderWatcher {
+    mc_Instance* _instance;
+    mc_Mutex* lock; // guards everything below
+    bool stop;
+    mc_Thread* thread;
+    int notifyFd; // inotify instance, -1 if the files are polled instead
+    uint32_t entryCount;
+    mc_WatchEntry** entries;
+};
+
+#endif // MC_SHADER_WATCHER_H
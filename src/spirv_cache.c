@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instance.h"
+#include "log.h"
+#include "misc.h"
+#include "spirv_cache.h"
+
+#define MC_SPIRV_CACHE_MAGIC 0x4353434d // "MCSC"
+#define MC_SPIRV_CACHE_VERSION 2
+#define MC_SPIRV_MAGIC 0x07230203
+#define MC_SPIRV_CACHE_MAX_SIZE ((uint64_t)256 << 20)
+#define MC_SPIRV_CACHE_MAX_DEPS 4096
+#define MC_SPIRV_CACHE_MAX_PATH 4096
+
+typedef struct mc_SpirvCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash[2];
+    uint64_t size;
+    uint64_t checksum;
+    uint32_t depCount;
+    uint32_t reserved;
+} mc_SpirvCacheHeader;
+
+// each included file is stored after the code as its path length, path and the
+// hash of its contents when the entry was stored
+static bool mc_spirv_cache_read_deps(
+    FILE* fp,
+    uint32_t depCount,
+    char** deps,
+    uint64_t* depHashes
+) {
+    for (uint32_t i = 0; i < depCount; i++) {
+        uint32_t len;
+        if (fread(&len, sizeof len, 1, fp) != 1 || len == 0
+            || len > MC_SPIRV_CACHE_MAX_PATH)
+            return false;
+
+        deps[i] = malloc(len + 1);
+        deps[i][len] = '\0';
+
+        uint64_t hash;
+        if (fread(deps[i], 1, len, fp) != len
+            || fread(&depHashes[i], sizeof *depHashes, 1, fp) != 1
+            || !mc_hash_file(deps[i], &hash) || hash != depHashes[i])
+            return false;
+    }
+
+    return true;
+}
+
+static char* mc_spirv_cache_path(mc_Instance* instance, mc_SpirvCacheKey key) {
+    const char* fmt = "%s/%016llx%016llx.spv";
+    unsigned long long h0 = key.hash[0], h1 = key.hash[1];
+    int len = snprintf(NULL, 0, fmt, instance->cacheDir, h0, h1);
+    char* path = malloc(len + 1);
+    snprintf(path, len + 1, fmt, instance->cacheDir, h0, h1);
+    return path;
+}
+
+bool mc_spirv_cache_load(
+    mc_Instance* instance,
+    mc_SpirvCacheKey key,
+    mc_ProgramCode* programCode
+) {
+    if (!instance->cacheDir) return false;
+
+    char* path = mc_spirv_cache_path(instance, key);
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        DEBUG(instance, "no cached SPIR-V at %s", path);
+        free(path);
+        return false;
+    }
+
+    mc_SpirvCacheHeader header;
+    char* data = NULL;
+    char** deps = NULL;
+    uint64_t* depHashes = NULL;
+
+    // any mismatch means the entry is stale or corrupted: drop it, the caller
+    // will compile the code again and overwrite it
+    if (fread(&header, sizeof header, 1, fp) != 1
+        || header.magic != MC_SPIRV_CACHE_MAGIC
+        || header.version != MC_SPIRV_CACHE_VERSION
+        || header.hash[0] != key.hash[0] || header.hash[1] != key.hash[1]
+        || header.size == 0 || header.size % 4 != 0
+        || header.size > MC_SPIRV_CACHE_MAX_SIZE
+        || header.depCount > MC_SPIRV_CACHE_MAX_DEPS)
+        goto invalid;
+
+    data = malloc(header.size);
+    if (fread(data, 1, header.size, fp) != header.size) goto invalid;
+
+    if (mc_hash(MC_HASH_SEED, data, header.size) != header.checksum
+        || *(uint32_t*)data != MC_SPIRV_MAGIC)
+        goto invalid;
+
+    // a changed (or removed) include file makes the entry stale as well
+    deps = calloc(header.depCount, sizeof *deps);
+    depHashes = calloc(header.depCount, sizeof *depHashes);
+    if (!mc_spirv_cache_read_deps(fp, header.depCount, deps, depHashes)
+        || fgetc(fp) != EOF)
+        goto invalid;
+
+    DEBUG(instance, "loaded cached SPIR-V from %s", path);
+    fclose(fp);
+    free(path);
+
+    programCode->size = header.size;
+    programCode->code = data;
+    programCode->depCount = header.depCount;
+    programCode->deps = deps;
+    programCode->depHashes = depHashes;
+    return true;
+
+invalid:
+    WARN(instance, "ignoring invalid SPIR-V cache entry %s", path);
+    fclose(fp);
+    remove(path);
+    free(path);
+    free(data);
+    for (uint32_t i = 0; deps && i < header.depCount; i++) free(deps[i]);
+    free(deps);
+    free(depHashes);
+    return false;
+}
+
+typedef struct mc_SpirvCacheEntry {
+    mc_SpirvCacheHeader header;
+    mc_ProgramCode* programCode;
+} mc_SpirvCacheEntry;
+
+static bool mc_spirv_cache_write(FILE* fp, void* arg) {
+    mc_SpirvCacheEntry* entry = arg;
+    mc_ProgramCode* programCode = entry->programCode;
+    uint64_t size = entry->header.size;
+
+    bool ok = fwrite(&entry->header, sizeof entry->header, 1, fp) == 1
+           && fwrite(programCode->code, 1, size, fp) == size;
+
+    for (uint32_t i = 0; ok && i < programCode->depCount; i++) {
+        uint32_t len = strlen(programCode->deps[i]);
+        ok = fwrite(&len, sizeof len, 1, fp) == 1
+          && fwrite(programCode->deps[i], 1, len, fp) == len
+          && fwrite(&programCode->depHashes[i], sizeof(uint64_t), 1, fp) == 1;
+    }
+
+    return ok;
+}
+
+void mc_spirv_cache_store(
+    mc_Instance* instance,
+    mc_SpirvCacheKey key,
+    mc_ProgramCode* programCode
+) {
+    if (!instance->cacheDir) return;
+
+    const char* dir = instance->cacheDir;
+    if (!mc_make_dirs(dir)) {
+        WARN(instance, "failed to create cache directory %s", dir);
+        return;
+    }
+
+    mc_SpirvCacheEntry entry = {
+        .header = {
+            .magic = MC_SPIRV_CACHE_MAGIC,
+            .version = MC_SPIRV_CACHE_VERSION,
+            .hash = {key.hash[0], key.hash[1]},
+            .size = programCode->size,
+            .checksum
+            = mc_hash(MC_HASH_SEED, programCode->code, programCode->size),
+            .depCount = programCode->depCount,
+            .reserved = 0,
+        },
+        .programCode = programCode,
+    };
+
+    // batch compiles may store the same key from several threads at once, the
+    // program code tells them apart
+    char* path = mc_spirv_cache_path(instance, key);
+    if (mc_write_file_atomic(path, programCode, mc_spirv_cache_write, &entry))
+        DEBUG(instance, "stored SPIR-V in cache at %s", path);
+    else
+        WARN(instance, "failed to write SPIR-V cache entry %s", path);
+
+    free(path);
+}
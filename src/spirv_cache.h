@@ -0,0 +1,26 @@
+#ifndef MC_SPIRV_CACHE_H
+#define MC_SPIRV_CACHE_H
+
+#include "microcompute.h"
+#include "program_code.h"
+
+// two independent hashes of everything that affects the compiled code
+typedef struct mc_SpirvCacheKey {
+    uint64_t hash[2];
+} mc_SpirvCacheKey;
+
+// load the code and the included files of `programCode`, only succeeds if none
+// of the included files have changed since the entry was stored
+bool mc_spirv_cache_load(
+    mc_Instance* instance,
+    mc_SpirvCacheKey key,
+    mc_ProgramCode* programCode
+);
+
+void mc_spirv_cache_store(
+    mc_Instance* instance,
+    mc_SpirvCacheKey key,
+    mc_ProgramCode* programCode
+);
+
+#endif // MC_SPIRV_CACHE_H
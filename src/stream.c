@@ -0,0 +1,493 @@
+#include <stdlib.h>
+
+#include "buffer.h"
+#include "device.h"
+#include "log.h"
+#include "program.h"
+#include "stream.h"
+
+static void mc_stream_destroy_sync(mc_Stream* stream, mc_StreamSlot* slot) {
+    VkDevice dev = stream->program->device->dev;
+    if (slot->downloaded) vkDestroyFence(dev, slot->downloaded, NULL);
+    if (slot->computed) vkDestroySemaphore(dev, slot->computed, NULL);
+    if (slot->uploaded) vkDestroySemaphore(dev, slot->uploaded, NULL);
+    slot->downloaded = NULL;
+    slot->computed = NULL;
+    slot->uploaded = NULL;
+    slot->pending = false;
+}
+
+static bool mc_stream_create_sync(mc_Stream* stream, mc_StreamSlot* slot) {
+    VkDevice dev = stream->program->device->dev;
+
+    VkSemaphoreCreateInfo semInfo = {0};
+    semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fenceInfo = {0};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateSemaphore(dev, &semInfo, NULL, &slot->uploaded)
+        || vkCreateSemaphore(dev, &semInfo, NULL, &slot->computed)
+        || vkCreateFence(dev, &fenceInfo, NULL, &slot->downloaded)) {
+        ERROR(stream, "failed to create synchronization objects");
+        return false;
+    }
+
+    return true;
+}
+
+static bool mc_stream_submit(
+    mc_Stream* stream,
+    uint32_t queueIdx,
+    VkCommandBuffer cmdBuff,
+    VkSemaphore wait,
+    VkPipelineStageFlags waitStage,
+    VkSemaphore signal,
+    VkFence fence
+) {
+    VkSubmitInfo submitInfo = {0};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = wait ? 1 : 0;
+    submitInfo.pWaitSemaphores = &wait;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuff;
+    submitInfo.signalSemaphoreCount = signal ? 1 : 0;
+    submitInfo.pSignalSemaphores = &signal;
+
+    mc_Device* device = stream->program->device;
+    VkQueue queue = mc_device_lock_queue(device, queueIdx);
+    VkResult res = vkQueueSubmit(queue, 1, &submitInfo, fence);
+    mc_device_unlock_queue(device, queueIdx);
+
+    if (res) {
+        ERROR(stream, "failed to submit queue");
+        return false;
+    }
+
+    return true;
+}
+
+static bool mc_stream_record(mc_Stream* stream, mc_StreamSlot* slot) {
+    mc_Program* program = stream->program;
+
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    // upload: staging -> device
+    if (vkBeginCommandBuffer(slot->uploadCmdBuff, &beginInfo)) {
+        ERROR(stream, "failed to begin command buffer");
+        return false;
+    }
+
+    VkBufferCopy inRegion = {0};
+    inRegion.size = stream->inChunkSize;
+    vkCmdCopyBuffer(
+        slot->uploadCmdBuff,
+        slot->cpuIn->buf,
+        slot->gpuIn->buf,
+        1,
+        &inRegion
+    );
+
+    if (vkEndCommandBuffer(slot->uploadCmdBuff)) {
+        ERROR(stream, "failed to end command buffer");
+        return false;
+    }
+
+    // compute
+    if (vkBeginCommandBuffer(slot->computeCmdBuff, &beginInfo)) {
+        ERROR(stream, "failed to begin command buffer");
+        return false;
+    }
+
+    mc_program_record_dispatch(program, slot->computeCmdBuff, slot->descSet);
+
+    if (vkEndCommandBuffer(slot->computeCmdBuff)) {
+        ERROR(stream, "failed to end command buffer");
+        return false;
+    }
+
+    // download: device -> staging, made visible to the host
+    if (vkBeginCommandBuffer(slot->downloadCmdBuff, &beginInfo)) {
+        ERROR(stream, "failed to begin command buffer");
+        return false;
+    }
+
+    VkBufferCopy outRegion = {0};
+    outRegion.size = stream->outChunkSize;
+    vkCmdCopyBuffer(
+        slot->downloadCmdBuff,
+        slot->gpuOut->buf,
+        slot->cpuOut->buf,
+        1,
+        &outRegion
+    );
+
+    VkBufferMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot->cpuOut->buf;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(
+        slot->downloadCmdBuff,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0,
+        NULL,
+        1,
+        &barrier,
+        0,
+        NULL
+    );
+
+    if (vkEndCommandBuffer(slot->downloadCmdBuff)) {
+        ERROR(stream, "failed to end command buffer");
+        return false;
+    }
+
+    return true;
+}
+
+static bool mc_stream_setup(mc_Stream* stream) {
+    mc_Program* program = stream->program;
+    VkDevice dev = program->device->dev;
+
+    if (stream->descPool) {
+        vkDestroyDescriptorPool(dev, stream->descPool, NULL);
+        stream->descPool = NULL;
+    }
+
+    VkDescriptorPoolSize descPoolSizes[2];
+    uint32_t descPoolSizeCount
+        = mc_program_get_pool_sizes(program, stream->depth, descPoolSizes);
+
+    VkDescriptorPoolCreateInfo descPoolInfo = {0};
+    descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descPoolInfo.maxSets = stream->depth;
+    descPoolInfo.poolSizeCount = descPoolSizeCount;
+    descPoolInfo.pPoolSizes = descPoolSizes;
+
+    if (vkCreateDescriptorPool(dev, &descPoolInfo, NULL, &stream->descPool)) {
+        ERROR(stream, "failed to create descriptor pool");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < stream->depth; i++) {
+        mc_StreamSlot* slot = &stream->slots[i];
+
+        VkDescriptorSetAllocateInfo descAllocInfo = {0};
+        descAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descAllocInfo.descriptorPool = stream->descPool;
+        descAllocInfo.descriptorSetCount = 1;
+        descAllocInfo.pSetLayouts = &program->descSetLayout;
+
+        if (vkAllocateDescriptorSets(dev, &descAllocInfo, &slot->descSet)) {
+            ERROR(stream, "failed to allocate descriptor sets");
+            return false;
+        }
+
+        mc_Buffer* buffs[] = {slot->gpuIn, slot->gpuOut};
+        mc_program_write_descriptors(program, slot->descSet, buffs);
+
+        if (!mc_stream_record(stream, slot)) return false;
+    }
+
+    return true;
+}
+
+mc_Stream* mc_stream_create(
+    mc_Program* program,
+    uint64_t inChunkSize,
+    uint64_t outChunkSize,
+    uint32_t depth
+) {
+    if (!program) return NULL;
+
+    mc_Stream* stream = malloc(sizeof *stream);
+    *stream = (mc_Stream){
+        ._instance = program->_instance,
+        .program = program,
+        .inChunkSize = inChunkSize,
+        .outChunkSize = outChunkSize,
+        .depth = depth < 2 ? 2 : depth,
+        .slots = NULL,
+        .descPool = NULL,
+        .cmdPool = NULL,
+        .throughput = 0.0,
+        .broken = false,
+    };
+
+    DEBUG(
+        stream,
+        "creating stream, chunk size: %ld -> %ld, depth: %d",
+        inChunkSize,
+        outChunkSize,
+        stream->depth
+    );
+
+    if (inChunkSize == 0 || outChunkSize == 0) {
+        ERROR(stream, "chunk size is 0");
+        mc_stream_destroy(stream);
+        return NULL;
+    }
+
+    mc_Device* device = program->device;
+
+    stream->slots = calloc(stream->depth, sizeof *stream->slots);
+
+    VkCommandPoolCreateInfo cmdPoolInfo = {0};
+    cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmdPoolInfo.queueFamilyIndex = device->queueFamilyIdx;
+
+    if (vkCreateCommandPool(
+            device->dev,
+            &cmdPoolInfo,
+            NULL,
+            &stream->cmdPool
+        )) {
+        ERROR(stream, "failed to create command pool");
+        mc_stream_destroy(stream);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < stream->depth; i++) {
+        mc_StreamSlot* slot = &stream->slots[i];
+
+        slot->cpuIn = mc_buffer_create(device, MC_BUFFER_TYPE_CPU, inChunkSize);
+        slot->gpuIn = mc_buffer_create(device, MC_BUFFER_TYPE_GPU, inChunkSize);
+        slot->gpuOut
+            = mc_buffer_create(device, MC_BUFFER_TYPE_GPU, outChunkSize);
+        slot->cpuOut
+            = mc_buffer_create(device, MC_BUFFER_TYPE_CPU, outChunkSize);
+
+        if (!slot->cpuIn || !slot->gpuIn || !slot->gpuOut || !slot->cpuOut) {
+            ERROR(stream, "failed to create stream buffers");
+            mc_stream_destroy(stream);
+            return NULL;
+        }
+
+        VkCommandBufferAllocateInfo cmdBuffAllocInfo = {0};
+        cmdBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmdBuffAllocInfo.commandPool = stream->cmdPool;
+        cmdBuffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmdBuffAllocInfo.commandBufferCount = 3;
+
+        VkCommandBuffer cmdBuffs[3];
+        if (vkAllocateCommandBuffers(
+                device->dev,
+                &cmdBuffAllocInfo,
+                cmdBuffs
+            )) {
+            ERROR(stream, "failed to allocate command buffers");
+            mc_stream_destroy(stream);
+            return NULL;
+        }
+
+        slot->uploadCmdBuff = cmdBuffs[0];
+        slot->computeCmdBuff = cmdBuffs[1];
+        slot->downloadCmdBuff = cmdBuffs[2];
+
+        if (!mc_stream_create_sync(stream, slot)) {
+            mc_stream_destroy(stream);
+            return NULL;
+        }
+    }
+
+    return stream;
+}
+
+void mc_stream_destroy(mc_Stream* stream) {
+    if (!stream) return;
+    DEBUG(stream, "destroying stream");
+
+    VkDevice dev = stream->program->device->dev;
+
+    if (stream->slots) {
+        for (uint32_t i = 0; i < stream->depth; i++) {
+            mc_StreamSlot* slot = &stream->slots[i];
+            if (slot->pending)
+                vkWaitForFences(dev, 1, &slot->downloaded, VK_TRUE, UINT64_MAX);
+            mc_stream_destroy_sync(stream, slot);
+            if (slot->cpuIn) mc_buffer_destroy(slot->cpuIn);
+            if (slot->gpuIn) mc_buffer_destroy(slot->gpuIn);
+            if (slot->gpuOut) mc_buffer_destroy(slot->gpuOut);
+            if (slot->cpuOut) mc_buffer_destroy(slot->cpuOut);
+        }
+        free(stream->slots);
+    }
+
+    if (stream->descPool)
+        vkDestroyDescriptorPool(dev, stream->descPool, NULL);
+    if (stream->cmdPool) vkDestroyCommandPool(dev, stream->cmdPool, NULL);
+    free(stream);
+}
+
+double mc_stream_run(
+    mc_Stream* stream,
+    uint64_t chunkCount,
+    uint32_t dimX,
+    uint32_t dimY,
+    uint32_t dimZ,
+    mc_stream_in_fn* in_fn,
+    mc_stream_out_fn* out_fn,
+    void* arg
+) {
+    if (!stream) return -1.0;
+    DEBUG(
+        stream,
+        "streaming %ld chunk(s) through %dx%dx%d program",
+        chunkCount,
+        dimX,
+        dimY,
+        dimZ
+    );
+
+    if (stream->broken) {
+        ERROR(stream, "stream is unusable after a failed recovery");
+        return -1.0;
+    }
+
+    if (dimX * dimY * dimZ == 0) {
+        ERROR(stream, "at least one dimension is 0");
+        return -1.0;
+    }
+
+    mc_Program* program = stream->program;
+    VkDevice dev = program->device->dev;
+
+    // build the pipeline for a (input, output) binding pair, then record the
+    // command buffers of every slot against it
+    mc_Buffer* buffs[] = {stream->slots[0].gpuIn, stream->slots[0].gpuOut};
+    if (!mc_program_configure(program, dimX, dimY, dimZ, 2, buffs)) {
+        ERROR(stream, "failed to configure program");
+        return -1.0;
+    }
+
+    if (!mc_stream_setup(stream)) return -1.0;
+
+    // everything goes to the queue of the program
+    uint32_t queueIdx = program->queueIdx;
+
+    double startTime = mc_get_time();
+    double firstTime = startTime, lastTime = startTime;
+
+    // software pipeline: at step t chunk t is uploaded, chunk t - 1 is
+    // computed and chunk t - 2 is downloaded, all in flight at the same time
+    for (uint64_t t = 0; t < chunkCount + 2; t++) {
+        if (t >= 1 && t <= chunkCount) {
+            mc_StreamSlot* slot = &stream->slots[(t - 1) % stream->depth];
+            if (!mc_stream_submit(
+                    stream,
+                    queueIdx,
+                    slot->computeCmdBuff,
+                    slot->uploaded,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    slot->computed,
+                    VK_NULL_HANDLE
+                ))
+                goto error;
+        }
+
+        if (t >= 2) {
+            mc_StreamSlot* slot = &stream->slots[(t - 2) % stream->depth];
+            if (!mc_stream_submit(
+                    stream,
+                    queueIdx,
+                    slot->downloadCmdBuff,
+                    slot->computed,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_NULL_HANDLE,
+                    slot->downloaded
+                ))
+                goto error;
+            slot->pending = true;
+        }
+
+        if (t >= chunkCount) continue;
+
+        // wait for the slot to be free, handing its result to the caller
+        uint64_t prev = t - stream->depth;
+        mc_StreamSlot* slot = &stream->slots[t % stream->depth];
+        if (slot->pending) {
+            if (vkWaitForFences(dev, 1, &slot->downloaded, VK_TRUE, UINT64_MAX)
+                || vkResetFences(dev, 1, &slot->downloaded)) {
+                ERROR(stream, "failed to wait for fence");
+                goto error;
+            }
+            slot->pending = false;
+
+            if (out_fn)
+                out_fn(arg, prev, stream->outChunkSize, slot->cpuOut->map);
+            lastTime = mc_get_time();
+            if (prev == 0) firstTime = lastTime;
+        }
+
+        if (in_fn) in_fn(arg, t, stream->inChunkSize, slot->cpuIn->map);
+
+        if (!mc_stream_submit(
+                stream,
+                queueIdx,
+                slot->uploadCmdBuff,
+                VK_NULL_HANDLE,
+                0,
+                slot->uploaded,
+                VK_NULL_HANDLE
+            ))
+            goto error;
+    }
+
+    // drain the remaining chunks in order
+    uint64_t i = chunkCount > stream->depth ? chunkCount - stream->depth : 0;
+    for (; i < chunkCount; i++) {
+        mc_StreamSlot* slot = &stream->slots[i % stream->depth];
+        if (!slot->pending) continue;
+
+        if (vkWaitForFences(dev, 1, &slot->downloaded, VK_TRUE, UINT64_MAX)
+            || vkResetFences(dev, 1, &slot->downloaded)) {
+            ERROR(stream, "failed to wait for fence");
+            goto error;
+        }
+        slot->pending = false;
+
+        if (out_fn) out_fn(arg, i, stream->outChunkSize, slot->cpuOut->map);
+        lastTime = mc_get_time();
+        if (i == 0) firstTime = lastTime;
+    }
+
+    // the first chunk includes the pipeline fill, so leave it out
+    double endTime = mc_get_time();
+    if (chunkCount > 1 && lastTime > firstTime) {
+        stream->throughput
+            = (double)((chunkCount - 1) * stream->inChunkSize)
+            / (lastTime - firstTime);
+    } else if (chunkCount > 0 && endTime > startTime) {
+        stream->throughput = (double)(chunkCount * stream->inChunkSize)
+                           / (endTime - startTime);
+    }
+
+    DEBUG(stream, "steady-state throughput: %f[B/s]", stream->throughput);
+
+    return endTime - startTime;
+
+error:
+    // semaphores may be left signaled, so start over with fresh ones
+    vkQueueWaitIdle(mc_device_lock_queue(program->device, queueIdx));
+    mc_device_unlock_queue(program->device, queueIdx);
+    for (uint32_t j = 0; j < stream->depth; j++) {
+        mc_stream_destroy_sync(stream, &stream->slots[j]);
+        if (!mc_stream_create_sync(stream, &stream->slots[j]))
+            stream->broken = true;
+    }
+    return -1.0;
+}
+
+double mc_stream_get_throughput(mc_Stream* stream) {
+    return stream ? stream->throughput : 0.0;
+}
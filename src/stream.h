@@ -0,0 +1,37 @@
+#ifndef MC_STREAM_H
+#define MC_STREAM_H
+
+#include <vulkan/vulkan.h>
+
+#include "microcompute.h"
+#include "microcompute_extra.h"
+
+typedef struct mc_StreamSlot {
+    mc_Buffer* cpuIn;
+    mc_Buffer* gpuIn;
+    mc_Buffer* gpuOut;
+    mc_Buffer* cpuOut;
+    VkDescriptorSet descSet;
+    VkCommandBuffer uploadCmdBuff;
+    VkCommandBuffer computeCmdBuff;
+    VkCommandBuffer downloadCmdBuff;
+    VkSemaphore uploaded;
+    VkSemaphore computed;
+    VkFence downloaded;
+    bool pending;
+} mc_StreamSlot;
+
+struct mc_Stream {
+    mc_Instance* _instance;
+    mc_Program* program;
+    uint64_t inChunkSize;
+    uint64_t outChunkSize;
+    uint32_t depth;
+    mc_StreamSlot* slots;
+    VkDescriptorPool descPool;
+    VkCommandPool cmdPool;
+    double throughput;
+    bool broken; // failed to recover from an error, every run fails
+};
+
+#endif // MC_STREAM_H
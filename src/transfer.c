@@ -0,0 +1,207 @@
+#include <stdlib.h>
+
+#include "buffer.h"
+#include "device.h"
+#include "log.h"
+#include "transfer.h"
+
+mc_Transfer* mc_transfer_create(
+    mc_Device* device,
+    uint64_t stagingSize,
+    uint32_t slotCount
+) {
+    if (!device) return NULL;
+    if (!mc_device_open(device)) return NULL;
+
+    mc_Transfer* transfer = malloc(sizeof *transfer);
+    *transfer = (mc_Transfer){
+        ._instance = device->_instance,
+        .device = device,
+        .slotCount = slotCount < 1 ? 1 : slotCount,
+        .slots = NULL,
+        .cmdPool = NULL,
+    };
+
+    transfer->slots = calloc(transfer->slotCount, sizeof *transfer->slots);
+
+    VkCommandPoolCreateInfo cmdPoolInfo = {0};
+    cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+                      | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    cmdPoolInfo.queueFamilyIndex = device->queueFamilyIdx;
+
+    if (vkCreateCommandPool(
+            device->dev,
+            &cmdPoolInfo,
+            NULL,
+            &transfer->cmdPool
+        )) {
+        ERROR(transfer, "failed to create command pool");
+        mc_transfer_destroy(transfer);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < transfer->slotCount; i++) {
+        mc_TransferSlot* slot = &transfer->slots[i];
+
+        if (stagingSize) {
+            slot->buff
+                = mc_buffer_create(device, MC_BUFFER_TYPE_CPU, stagingSize);
+            if (!slot->buff) {
+                mc_transfer_destroy(transfer);
+                return NULL;
+            }
+        }
+
+        VkCommandBufferAllocateInfo cmdBuffAllocInfo = {0};
+        cmdBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmdBuffAllocInfo.commandPool = transfer->cmdPool;
+        cmdBuffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmdBuffAllocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(
+                device->dev,
+                &cmdBuffAllocInfo,
+                &slot->cmdBuff
+            )) {
+            ERROR(transfer, "failed to allocate command buffer");
+            mc_transfer_destroy(transfer);
+            return NULL;
+        }
+
+        VkFenceCreateInfo fenceInfo = {0};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(device->dev, &fenceInfo, NULL, &slot->fence)) {
+            ERROR(transfer, "failed to create fence");
+            mc_transfer_destroy(transfer);
+            return NULL;
+        }
+    }
+
+    return transfer;
+}
+
+void mc_transfer_destroy(mc_Transfer* transfer) {
+    if (!transfer) return;
+
+    VkDevice dev = transfer->device->dev;
+
+    if (transfer->slots) {
+        for (uint32_t i = 0; i < transfer->slotCount; i++) {
+            mc_TransferSlot* slot = &transfer->slots[i];
+            mc_transfer_wait(transfer, slot);
+            if (slot->fence) vkDestroyFence(dev, slot->fence, NULL);
+            if (slot->buff) mc_buffer_destroy(slot->buff);
+        }
+        free(transfer->slots);
+    }
+
+    if (transfer->cmdPool) vkDestroyCommandPool(dev, transfer->cmdPool, NULL);
+    free(transfer);
+}
+
+mc_TransferSlot* mc_transfer_acquire(mc_Transfer* transfer, uint64_t idx) {
+    mc_TransferSlot* slot = &transfer->slots[idx % transfer->slotCount];
+    return mc_transfer_wait(transfer, slot) ? slot : NULL;
+}
+
+bool mc_transfer_copy(
+    mc_Transfer* transfer,
+    mc_TransferSlot* slot,
+    mc_Buffer* src,
+    mc_Buffer* dst,
+    uint64_t srcOffset,
+    uint64_t dstOffset,
+    uint64_t size
+) {
+    if (srcOffset + size > src->size || dstOffset + size > dst->size) {
+        ERROR(transfer, "offset + size > buffer size");
+        return false;
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {0};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(slot->cmdBuff, &beginInfo)) {
+        ERROR(transfer, "failed to begin command buffer");
+        return false;
+    }
+
+    VkBufferCopy region = {0};
+    region.srcOffset = srcOffset;
+    region.dstOffset = dstOffset;
+    region.size = size;
+    vkCmdCopyBuffer(slot->cmdBuff, src->buf, dst->buf, 1, &region);
+
+    // make downloads visible to the host once the fence is signaled
+    if (dst->map) {
+        VkBufferMemoryBarrier barrier = {0};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = dst->buf;
+        barrier.offset = dstOffset;
+        barrier.size = size;
+
+        vkCmdPipelineBarrier(
+            slot->cmdBuff,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            0,
+            NULL,
+            1,
+            &barrier,
+            0,
+            NULL
+        );
+    }
+
+    if (vkEndCommandBuffer(slot->cmdBuff)) {
+        ERROR(transfer, "failed to end command buffer");
+        return false;
+    }
+
+    VkSubmitInfo submitInfo = {0};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &slot->cmdBuff;
+
+    VkQueue queue = mc_device_lock_queue(transfer->device, 0);
+    VkResult res = vkQueueSubmit(queue, 1, &submitInfo, slot->fence);
+    mc_device_unlock_queue(transfer->device, 0);
+
+    if (res) {
+        ERROR(transfer, "failed to submit queue");
+        return false;
+    }
+
+    slot->pending = true;
+    return true;
+}
+
+bool mc_transfer_wait(mc_Transfer* transfer, mc_TransferSlot* slot) {
+    if (!slot->pending) return true;
+
+    VkDevice dev = transfer->device->dev;
+    slot->pending = false;
+
+    if (vkWaitForFences(dev, 1, &slot->fence, VK_TRUE, UINT64_MAX)
+        || vkResetFences(dev, 1, &slot->fence)) {
+        ERROR(transfer, "failed to wait for fence");
+        return false;
+    }
+
+    return true;
+}
+
+bool mc_transfer_finish(mc_Transfer* transfer) {
+    bool ok = true;
+    for (uint32_t i = 0; i < transfer->slotCount; i++)
+        ok = mc_transfer_wait(transfer, &transfer->slots[i]) && ok;
+    return ok;
+}
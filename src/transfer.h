@@ -0,0 +1,52 @@
+#ifndef MC_TRANSFER_H
+#define MC_TRANSFER_H
+
+#include <vulkan/vulkan.h>
+
+#include "microcompute.h"
+
+// default size of the chunks streamed through a transfer ring
+#define MC_TRANSFER_CHUNK_SIZE ((uint64_t)8 << 20)
+
+typedef struct mc_TransferSlot {
+    mc_Buffer* buff; // staging buffer, `NULL` if the ring has none
+    VkCommandBuffer cmdBuff;
+    VkFence fence;
+    bool pending;
+} mc_TransferSlot;
+
+// a ring of command buffers (and optionally staging buffers) used to keep
+// several copies in flight while the host works on the next chunk
+typedef struct mc_Transfer {
+    mc_Instance* _instance;
+    mc_Device* device;
+    uint32_t slotCount;
+    mc_TransferSlot* slots;
+    VkCommandPool cmdPool;
+} mc_Transfer;
+
+mc_Transfer* mc_transfer_create(
+    mc_Device* device,
+    uint64_t stagingSize,
+    uint32_t slotCount
+);
+
+void mc_transfer_destroy(mc_Transfer* transfer);
+
+mc_TransferSlot* mc_transfer_acquire(mc_Transfer* transfer, uint64_t idx);
+
+bool mc_transfer_copy(
+    mc_Transfer* transfer,
+    mc_TransferSlot* slot,
+    mc_Buffer* src,
+    mc_Buffer* dst,
+    uint64_t srcOffset,
+    uint64_t dstOffset,
+    uint64_t size
+);
+
+bool mc_transfer_wait(mc_Transfer* transfer, mc_TransferSlot* slot);
+
+bool mc_transfer_finish(mc_Transfer* transfer);
+
+#endif // MC_TRANSFER_H